@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# Records golden results of tasks/GoldenRegression.xml into data/golden, using the
+# processors of the baseline version (before the optimizations).
+#
+# Usage: data/record_golden.sh [BASELINE]
+#
+#   BASELINE  commit with the reference processors, by default the first commit
+#
+# Baseline is checked out into a temporary worktree, extended with the GoldenCompare
+# sink of the current tree, and built. The task is run in record mode from a temporary
+# DCL directory, in which the other DCLs (CvCoreTypes etc.) are linked from
+# DISCODE_DCL_DIR, so the installed CvBasic is left as it is.
+#
+# Skeletonization output was changed on purpose (neighbour count, stop condition and
+# border pixels, see the history of src/Components/Skeletonization), so skeleton.cvraw
+# is recorded with the installed (current) CvBasic - review its output first.
+#
+# Requires discode in PATH, DISCODE_DCL_DIR set, installed current CvBasic and the
+# opencv_classics dataset (make dataset). DisCODe doesn't stop at the end of the
+# sequence, so each run is interrupted after DURATION seconds (60 by default).
+
+set -e
+
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+BASELINE=${1:-$(git -C "$SRC" rev-list --max-parents=0 HEAD)}
+DURATION=${DURATION:-60}
+
+if [ -z "$DISCODE_DCL_DIR" ]; then
+	echo "DISCODE_DCL_DIR is not set" >&2
+	exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'git -C "$SRC" worktree remove --force "$WORK/dcl/CvBasic" >/dev/null 2>&1; rm -rf "$WORK"' EXIT
+
+# Baseline processors with the current GoldenCompare sink.
+mkdir -p "$WORK/dcl"
+git -C "$SRC" worktree add --detach "$WORK/dcl/CvBasic" "$BASELINE"
+BASE="$WORK/dcl/CvBasic"
+cp -r "$SRC/src/Components/GoldenCompare" "$BASE/src/Components/"
+cp "$SRC/src/Types/FrameContainer.hpp" "$BASE/src/Types/"
+grep -q "ADD_COMPONENT(GoldenCompare)" "$BASE/src/Components/CMakeLists.txt" ||
+	echo "ADD_COMPONENT(GoldenCompare)" >> "$BASE/src/Components/CMakeLists.txt"
+
+for dcl in "$DISCODE_DCL_DIR"/*; do
+	[ "$(basename "$dcl")" = CvBasic ] || ln -s "$dcl" "$WORK/dcl/"
+done
+
+mkdir "$BASE/build"
+(cd "$BASE/build" && DISCODE_DCL_DIR="$WORK/dcl" cmake .. && make -j"$(nproc)" install)
+
+# Runs the task in record mode with given DCL directory, results are written to $2.
+record() {
+	mkdir -p "$2"
+	sed -e 's|<param name="mode">compare</param>|<param name="mode">record</param>|' \
+		-e "s|%\[TASK_LOCATION\]%/../data/golden|$2|" \
+		-e "s|%\[TASK_LOCATION\]%/../data/|$SRC/data/|" \
+		-e 's|golden_regression.csv||' \
+		"$SRC/tasks/GoldenRegression.xml" > "$WORK/GoldenRecord.xml"
+	DISCODE_DCL_DIR="$1" timeout -s INT "$DURATION" discode -T "$WORK/GoldenRecord.xml" || true
+}
+
+record "$WORK/dcl" "$WORK/baseline"
+record "$DISCODE_DCL_DIR" "$WORK/current"
+
+mkdir -p "$SRC/data/golden"
+for name in hsvlut rgblut harris; do
+	cp "$WORK/baseline/$name.cvraw" "$SRC/data/golden/"
+done
+cp "$WORK/current/skeleton.cvraw" "$SRC/data/golden/"
+
+echo "Golden results of $BASELINE recorded in $SRC/data/golden"
@@ -6,6 +6,7 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include <boost/bind.hpp>
 
@@ -16,6 +17,10 @@ namespace Sources {
 namespace CameraOpenCV {
 
 CameraOpenCV_Source::CameraOpenCV_Source(const std::string & name) : Base::Component(name),
+		m_async("async", false),
+		m_pool_size("pool.size", 8),
+		m_skip_every("skip.every", 1),
+		m_skip_adaptive("skip.adaptive", false),
 		m_device("device", boost::bind(&CameraOpenCV_Source::onDeviceCahnged, this, _1, _2), 0),
 		m_width("width", 640, "combo"),
 		m_height("width", 480, "combo"),
@@ -35,8 +40,21 @@ CameraOpenCV_Source::CameraOpenCV_Source(const std::string & name) : Base::Compo
 	registerProperty(m_height);
 
 	registerProperty(m_triggered);
+	registerProperty(m_async);
+	registerProperty(m_pool_size);
+	registerProperty(m_skip_every);
+	registerProperty(m_skip_adaptive);
 
 	valid = false;
+	m_change_device = false;
+	grab_stop = false;
+	latest_fresh = false;
+	frame_counter = 0;
+	dropped = 0;
+	frame_type = 0;
+	ready_seen = false;
+	waiting_ready = false;
+	skipped = 0;
 }
 
 CameraOpenCV_Source::~CameraOpenCV_Source() {
@@ -49,12 +67,21 @@ void CameraOpenCV_Source::prepareInterface() {
 	registerHandler("onGrabFrame", boost::bind(&CameraOpenCV_Source::onGrabFrame, this));
 	addDependency("onGrabFrame", NULL);
 
+	registerHandler("onReady", boost::bind(&CameraOpenCV_Source::onReady, this));
+	addDependency("onReady", &in_ready);
+	registerStream("in_ready", &in_ready);
+
 	registerStream("out_img", &out_img);
+	registerStream("out_timestamp", &out_timestamp);
+	registerStream("out_frame_number", &out_frame_number);
 }
 
 bool CameraOpenCV_Source::onInit() {
 	LOG(LTRACE) << "CameraOpenCV_Source::initialize()\n";
 
+	pool.setCapacity(std::max((int)m_pool_size, 0));
+	pool.resetCounters();
+
 	cap.open(m_device);
 
 	if (cap.isOpened()) {
@@ -81,8 +108,16 @@ bool CameraOpenCV_Source::onInit() {
 
 bool CameraOpenCV_Source::onFinish() {
 	LOG(LTRACE) << "CameraOpenCV_Source::finish()\n";
+	stopGrabbing();
 	cap.release();
 
+	if (!m_async && skipped > 0)
+		LOG(LINFO) << "CameraOpenCV: grabbed " << frame_counter << " frames, skipped without decoding " << skipped;
+	LOG(LINFO) << "CameraOpenCV: image buffers: " << pool.size() << " in use: " << pool.inUse()
+			<< " allocations: " << pool.allocations() << " of " << pool.requests()
+			<< " (" << pool.overflows() << " outside the pool)";
+	pool.clear();
+
 	return !cap.isOpened();
 }
 
@@ -97,8 +132,46 @@ void CameraOpenCV_Source::onGrabFrame() {
 	if (m_triggered && !trig)
 		return;
 
+	boost::posix_time::ptime tm;
+	int number;
+
+	if (grab_thread) {
+		// Take the newest frame, waiting a while if it was already published.
+		boost::mutex::scoped_lock lock(grab_mutex);
+		if (!latest_fresh)
+			grab_cond.timed_wait(lock, boost::posix_time::milliseconds(100));
+		if (!latest_fresh)
+			return;
+
+		frame = latest;
+		tm = latest_time;
+		number = frame_counter;
+		latest_fresh = false;
+	} else {
+		// Downstream readiness is set by onReady, which can run in another thread.
+		bool skip;
+		{
+			boost::mutex::scoped_lock lock(grab_mutex);
+			skip = skipNext();
+		}
+
+		if (skip) {
+			// Drain the device without decoding.
+			if (cap.grab()) {
+				++frame_counter;
+				++skipped;
+			}
+			return;
+		}
+
+		// Buffer not referenced downstream anymore - it's passed further without copying.
+		frame = Mat();
+		readFrame(frame);
+		tm = boost::posix_time::microsec_clock::universal_time();
+		number = ++frame_counter;
+	}
+
 	trig = false;
-	cap >> frame;
 
 	if (frame.empty()) {
 		return;
@@ -106,15 +179,40 @@ void CameraOpenCV_Source::onGrabFrame() {
 
 	LOG(LTRACE) << "CameraOpenCV: got frame!\n";
 
+	// Set before publishing - token sent back for this frame can arrive before write returns.
+	if (m_skip_adaptive) {
+		boost::mutex::scoped_lock lock(grab_mutex);
+		waiting_ready = ready_seen;
+	}
+
+	boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+	out_timestamp.write((tm - epoch).total_microseconds() / 1e6);
+	out_frame_number.write(number);
 	out_img.write(frame);
+}
+
+void CameraOpenCV_Source::onReady() {
+	in_ready.read();
+
+	boost::mutex::scoped_lock lock(grab_mutex);
+	ready_seen = true;
+	waiting_ready = false;
+}
 
+bool CameraOpenCV_Source::skipNext() const {
+	if (m_skip_every > 1 && frame_counter % m_skip_every != 0)
+		return true;
+
+	return m_skip_adaptive && waiting_ready;
 }
 
 bool CameraOpenCV_Source::onStart() {
+	startGrabbing();
 	return true;
 }
 
 bool CameraOpenCV_Source::onStop() {
+	stopGrabbing();
 	return true;
 }
 
@@ -131,6 +229,7 @@ void CameraOpenCV_Source::onDeviceCahnged(int old_device, int new_device) {
 void CameraOpenCV_Source::changeDevice() {
 	m_change_device = false;
 	valid = false;
+	stopGrabbing();
 	cap.release();
 	cap.open(m_device);
 
@@ -139,6 +238,90 @@ void CameraOpenCV_Source::changeDevice() {
 	}
 
 	valid = true;
+	startGrabbing();
+}
+
+void CameraOpenCV_Source::startGrabbing() {
+	if (!m_async || grab_thread || !cap.isOpened())
+		return;
+
+	grab_stop = false;
+	latest_fresh = false;
+	dropped = 0;
+	skipped = 0;
+	grab_thread.reset(new boost::thread(boost::bind(&CameraOpenCV_Source::grabLoop, this)));
+}
+
+void CameraOpenCV_Source::stopGrabbing() {
+	if (!grab_thread)
+		return;
+
+	{
+		boost::mutex::scoped_lock lock(grab_mutex);
+		grab_stop = true;
+	}
+	grab_thread->join();
+	grab_thread.reset();
+
+	LOG(LINFO) << "CameraOpenCV: grabbed " << frame_counter << " frames, dropped " << dropped
+			<< ", skipped without decoding " << skipped;
+}
+
+bool CameraOpenCV_Source::readFrame(Mat & img) {
+	// Frame of the same geometry is copied into the buffer without reallocation.
+	img = pool.acquire(frame_size, frame_type);
+	if (!cap.read(img) || img.empty())
+		return false;
+
+	if (img.size() != frame_size || img.type() != frame_type) {
+		frame_size = img.size();
+		frame_type = img.type();
+	}
+
+	return true;
+}
+
+void CameraOpenCV_Source::grabLoop() {
+	for (;;) {
+		bool skip;
+		{
+			boost::mutex::scoped_lock lock(grab_mutex);
+			if (grab_stop)
+				break;
+			skip = skipNext();
+		}
+
+		// Frame nobody waits for - drain the device without decoding.
+		if (skip) {
+			if (!cap.grab()) {
+				boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+				continue;
+			}
+			boost::mutex::scoped_lock lock(grab_mutex);
+			++frame_counter;
+			++skipped;
+			continue;
+		}
+
+		// Buffer not referenced downstream anymore, the previous one can be still processed.
+		Mat img;
+		if (!readFrame(img)) {
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+			continue;
+		}
+		boost::posix_time::ptime tm = boost::posix_time::microsec_clock::universal_time();
+
+		boost::mutex::scoped_lock lock(grab_mutex);
+		if (latest_fresh) {
+			++dropped;
+			LOG(LDEBUG) << "CameraOpenCV: frame dropped (" << dropped << " so far)";
+		}
+		latest = img;
+		latest_time = tm;
+		latest_fresh = true;
+		++frame_counter;
+		grab_cond.notify_all();
+	}
 }
 
 }//: namespace CameraOpenCV
@@ -17,6 +17,54 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "Types/FramePool.hpp"
+
+/**
+ * \defgroup CameraOpenCV CameraOpenCV
+ * \ingroup Sources
+ * \brief Camera reader, based on OpenCV.
+ *
+ *
+ *
+ * \par Data streams:
+ *
+ * \streamout{out_img,cv::Mat}
+ * Output image
+ * \streamout{out_timestamp,double}
+ * Capture time of the image (seconds since epoch)
+ * \streamout{out_frame_number,int}
+ * Number of the frame grabbed from device (frames dropped in async mode are counted too)
+ * \streamin{in_ready,Base::UnitType}
+ * Token sent by the last component of the processing chain when it has finished with the frame
+ *
+ *
+ * \par Properties:
+ *
+ * \prop{device,int,0}
+ * Device number
+ * \prop{async,bool,false}
+ * If set, frames are grabbed continuously by separate thread and only the newest
+ * one is published, so latency doesn't depend on the driver queue depth.
+ * \prop{pool.size,int,8}
+ * Number of image buffers recycled for consecutive frames
+ * \prop{skip.every,int,1}
+ * Only every N-th frame is published, the others are grabbed without decoding
+ * \prop{skip.adaptive,bool,false}
+ * If set, frames grabbed after publishing the image and before the next token
+ * on in_ready are not decoded (nor published). Until the first token arrives all
+ * frames are published.
+ *
+ * @{
+ *
+ * @}
+ */
+
 namespace Sources {
 namespace CameraOpenCV {
 
@@ -77,17 +125,105 @@ protected:
 	 */
 	void onGrabFrame();
 
+	/*!
+	 * Event handler function - downstream is ready for the next frame.
+	 */
+	void onReady();
+
 	/// Output data stream
 	Base::DataStreamOut<Mat> out_img;
 
 	/// Capture device
 	VideoCapture cap;
 
+	/// Output data stream - capture time of the image.
+	Base::DataStreamOut<double> out_timestamp;
+
+	/// Output data stream - number of the frame.
+	Base::DataStreamOut<int> out_frame_number;
+
+	/// Input data stream - downstream is ready for the next frame.
+	Base::DataStreamIn<Base::UnitType, Base::DataStreamBuffer::Newest> in_ready;
+
 	/// Movie frame
 	Mat frame;
 
 	bool trig;
 
+	/// Grab frames in separate thread.
+	Base::Property<bool> m_async;
+
+	/*!
+	 * Grabbing thread body - drains the device, keeping only the newest frame.
+	 */
+	void grabLoop();
+
+	/// Starts grabbing thread (if async mode is on).
+	void startGrabbing();
+
+	/// Stops grabbing thread.
+	void stopGrabbing();
+
+	/// Grabbing thread.
+	boost::shared_ptr<boost::thread> grab_thread;
+
+	/// Protects newest frame, counters and downstream readiness flags.
+	boost::mutex grab_mutex;
+
+	/// Signalled when new frame is grabbed.
+	boost::condition_variable grab_cond;
+
+	/// Set when grabbing thread should finish.
+	bool grab_stop;
+
+	/// Newest frame grabbed from device.
+	Mat latest;
+
+	/// Capture time of the newest frame.
+	boost::posix_time::ptime latest_time;
+
+	/// Set if the newest frame wasn't published yet.
+	bool latest_fresh;
+
+	/// Number of frames grabbed from device.
+	int frame_counter;
+
+	/// Number of frames overwritten before publishing.
+	unsigned long dropped;
+
+	/// Number of recycled image buffers.
+	Base::Property<int> m_pool_size;
+
+	/// Buffers for the grabbed frames.
+	Types::FramePool pool;
+
+	/// Geometry of the last grabbed frame - next one is retrieved into pool buffer of the same size.
+	cv::Size frame_size;
+	int frame_type;
+
+	/*!
+	 * Reads next frame from device into recycled buffer.
+	 */
+	bool readFrame(Mat & img);
+
+	/// Publish only every N-th frame.
+	Base::Property<int> m_skip_every;
+
+	/// Skip frames until downstream is ready.
+	Base::Property<bool> m_skip_adaptive;
+
+	/// Returns true if next frame should be grabbed without decoding. Grab mutex must be held.
+	bool skipNext() const;
+
+	/// Set when the first token on in_ready arrives.
+	bool ready_seen;
+
+	/// Set after publishing the image, until downstream is ready.
+	bool waiting_ready;
+
+	/// Number of frames grabbed without decoding.
+	unsigned long skipped;
+
 	Base::Property<int> m_device;
 	Base::Property<int> m_width;
 	Base::Property<int> m_height;
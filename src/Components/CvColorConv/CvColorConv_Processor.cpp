@@ -11,6 +11,7 @@
 
 #include "CvColorConv_Processor.hpp"
 #include "Logger.hpp"
+#include "Types/Instrumentation.hpp"
 
 namespace Processors {
 namespace CvColorConv {
@@ -74,9 +75,12 @@ bool CvColorConv_Processor::onStart()
 void CvColorConv_Processor::onNewImage()
 {
 	LOG(LTRACE) << "CvColorConv_Processor::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		img = in_img.read();
+		probe.bytesIn(img);
 		cvtColor(img, out, conversion_type);
+		probe.bytesOut(out);
 		out_img.write(out);
 	} catch (const exception& ex) {
 		LOG(LERROR) << "CvColorConv_Processor::onNewImage() failed. " << ex.what() << endl;
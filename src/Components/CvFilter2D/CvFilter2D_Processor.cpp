@@ -7,9 +7,12 @@
 
 #include <memory>
 #include <string>
+#include <algorithm>
 
 #include "CvFilter2D_Processor.hpp"
 #include "Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 namespace Processors {
 namespace CvFilter2D {
@@ -17,13 +20,16 @@ namespace CvFilter2D {
 CvFilter2D_Processor::CvFilter2D_Processor(const std::string & name) : Base::Component(name) ,
 		kernel("kernel", cv::Mat(cv::Mat::eye(3, 3, CV_32FC1))),
 		norm("norm", 1),
-		delta("delta", 0)
+		delta("delta", 0),
+		threads("threads", 1)
 {
 	LOG(LTRACE) << "Hello CvFilter2D_Processor\n";
 
 	registerProperty(kernel);
 	registerProperty(norm);
 	registerProperty(delta);
+	threads.setToolTip("Number of threads processing the image (0 - all cores)");
+	registerProperty(threads);
 }
 
 CvFilter2D_Processor::~CvFilter2D_Processor()
@@ -71,15 +77,39 @@ bool CvFilter2D_Processor::onStart()
 	return true;
 }
 
+void CvFilter2D_Processor::filterRows(const cv::Range & rows, const cv::Mat & img, const cv::Mat & k)
+{
+	cv::Mat dst = tmp.rowRange(rows);
+	if (rows.size() == img.rows) {
+		cv::filter2D(img, dst, -1, k, cv::Point(-1, -1), delta, cv::BORDER_REPLICATE);
+		return;
+	}
+
+	// Band is filtered together with the rows of its neighbours covered by the kernel,
+	// so the result is the same as for the whole image.
+	int above = k.rows / 2;
+	int start = std::max(rows.start - above, 0);
+	int end = std::min(rows.end + k.rows - 1 - above, img.rows);
+
+	cv::Mat band;
+	cv::filter2D(img.rowRange(start, end), band, -1, k, cv::Point(-1, -1), delta, cv::BORDER_REPLICATE | cv::BORDER_ISOLATED);
+	band.rowRange(rows.start - start, rows.end - start).copyTo(dst);
+}
+
 void CvFilter2D_Processor::onNewImage()
 {
 	LOG(LTRACE) << "CvFilter2D_Processor::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat img = in_img.read();
+		probe.bytesIn(img);
 
 		//img.convertTo(tmp, CV_32F, 1./255);
-		cv::filter2D(img, tmp, -1, norm * kernel, cv::Size(-1, -1), delta, cv::BORDER_REPLICATE);
+		cv::Mat k = norm * kernel;
+		tmp.create(img.size(), img.type());
+		Types::parallelRows(img.rows, threads, boost::bind(&CvFilter2D_Processor::filterRows, this, _1, boost::cref(img), boost::cref(k)));
 
+		probe.bytesOut(tmp);
 		out_img.write(tmp);
 	} catch (...) {
 		LOG(LERROR) << "CvFilter2D_Processor::onNewImage failed\n";
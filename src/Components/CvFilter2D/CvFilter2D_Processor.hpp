@@ -56,6 +56,8 @@
  * Kernel itself
  * \prop{norm,double,1.0}
  * Normalisation factor
+ * \prop{threads,int,1}
+ * Number of threads processing bands of rows (0 - all cores)
  *
  * \see http://opencv.willowgarage.com/documentation/cpp/image_filtering.html#filter2D
  * @{
@@ -121,6 +123,9 @@ protected:
 	 */
 	void onNewImage();
 
+	/// Filters given rows of the image (with kernel k).
+	void filterRows(const cv::Range & rows, const cv::Mat & img, const cv::Mat & k);
+
 	/// Input data stream
 	Base::DataStreamIn <Mat> in_img;
 
@@ -130,6 +135,7 @@ protected:
 	Base::Property<cv::Mat, Types::MatrixTranslator> kernel;
 	Base::Property<double> norm;
 	Base::Property<double> delta;
+	Base::Property<int> threads;
 
 private:
 	cv::Mat tmp;
@@ -6,6 +6,7 @@
 */
 
 #include "CvFindChessboardCorners_Processor.hpp"
+#include "Types/Instrumentation.hpp"
 #include <boost/bind.hpp>
 
 namespace Processors {
@@ -174,12 +175,14 @@ bool CvFindChessboardCorners_Processor::onStep() {
 void CvFindChessboardCorners_Processor::onNewImage() {
 	LOG(LTRACE)
 			<< "void CvFindChessboardCorners_Processor::onNewImage() begin\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		if (in_img.empty()) {
 			return;
 		}
 		// Retrieve image from the stream.
 		Mat image = in_img.read();
+		probe.bytesIn(image);
 
 		timer.restart();
 
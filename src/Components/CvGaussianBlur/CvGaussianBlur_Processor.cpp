@@ -10,6 +10,7 @@
 
 #include "CvGaussianBlur_Processor.hpp"
 #include "Logger.hpp"
+#include "Types/Instrumentation.hpp"
 
 namespace Processors {
 namespace CvGaussianBlur {
@@ -90,12 +91,15 @@ bool CvGaussianBlur_Processor::onStart()
 void CvGaussianBlur_Processor::onNewImage()
 {
 	LOG(LTRACE) << "CvGaussianBlur_Processor::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat img = in_img.read();
+		probe.bytesIn(img);
 		cv::Mat gray;
 		//cvtColor(img, gray, COLOR_BGR2GRAY);
 		//cv::Mat out = img.clone();
 		cv::GaussianBlur(img, img, cv::Size(kernel_width, kernel_height), sigmax, sigmay);
+		probe.bytesOut(img);
 		out_img.write(img);
 	} catch (...) {
 		LOG(LERROR) << "CvGaussianBlur_Processor::onNewImage failed\n";
@@ -10,6 +10,7 @@
 
 #include "CvHarris.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
 
 #include <boost/bind.hpp>
 
@@ -67,9 +68,11 @@ bool CvHarris::onStart() {
 void CvHarris::onNewImage()
 {
 	LOG(LTRACE) << "CvHarris::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		// Input: a grayscale image.
 		cv::Mat in = in_img.read();
+		probe.bytesIn(in);
 
 
 		Mat dst, dst_norm, dst_norm_scaled;
@@ -96,6 +99,7 @@ void CvHarris::onNewImage()
 
 		// Write features to the output.
 	    Types::Features features(keypoints);
+		probe.bytesOut(keypoints.size() * sizeof(cv::KeyPoint));
 		out_features.write(features);
 	} catch (...) {
 		LOG(LERROR) << "CvHarris::onNewImage failed\n";
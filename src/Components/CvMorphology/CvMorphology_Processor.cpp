@@ -10,6 +10,7 @@
 
 #include "CvMorphology_Processor.hpp"
 #include "Logger.hpp"
+#include "Types/Instrumentation.hpp"
 
 namespace Processors {
 namespace CvMorphology {
@@ -79,10 +80,13 @@ bool CvMorphology_Processor::onStart()
 void CvMorphology_Processor::onNewImage()
 {
 	LOG(LTRACE) << "CvMorphology_Processor::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
         cv::Mat in = in_img.read();
+        probe.bytesIn(in);
         cv::Mat out = in.clone();
         cv::morphologyEx(in, out, type, cv::Mat(), Point(-1, -1), iterations);
+        probe.bytesOut(out);
         out_img.write(out);
 	} catch (...) {
 		LOG(LERROR) << "CvMorphology_Processor::onNewImage failed\n";
@@ -10,6 +10,8 @@
 
 #include "CvThreshold_Processor.hpp"
 #include "Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 namespace Processors {
 namespace CvThreshold {
@@ -17,7 +19,8 @@ namespace CvThreshold {
 CvThreshold_Processor::CvThreshold_Processor(const std::string & name) : Base::Component(name),
 		m_type("type", THRESH_BINARY, "combo"),
 		m_thresh("thresh", 128, "range"),
-		m_maxval("maxval", 255, "range")
+		m_maxval("maxval", 255, "range"),
+		m_threads("threads", 1)
 {
 	LOG(LTRACE) << "Hello CvThreshold_Processor\n";
 
@@ -36,10 +39,13 @@ CvThreshold_Processor::CvThreshold_Processor(const std::string & name) : Base::C
 	m_maxval.addConstraint("0");
 	m_maxval.addConstraint("255");
 
+	m_threads.setToolTip("Number of threads processing the image (0 - all cores)");
+
 	// Register properties.
 	registerProperty(m_type);
 	registerProperty(m_thresh);
 	registerProperty(m_maxval);
+	registerProperty(m_threads);
 }
 
 CvThreshold_Processor::~CvThreshold_Processor()
@@ -84,14 +90,23 @@ bool CvThreshold_Processor::onStart()
 	return true;
 }
 
+void CvThreshold_Processor::thresholdRows(const cv::Range & rows, const cv::Mat & img, cv::Mat & out)
+{
+	cv::Mat band = out.rowRange(rows);
+	cv::threshold(img.rowRange(rows), band, m_thresh, m_maxval, m_type);
+}
+
 void CvThreshold_Processor::onNewImage()
 {
 	LOG(LNOTICE) << "CvThreshold_Processor::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat img = in_img.read();
-		cv::Mat out = img.clone();
+		probe.bytesIn(img);
+		cv::Mat out(img.size(), img.type());
 		LOG(LTRACE) << "Threshold " << m_thresh;
-		cv::threshold(img, out, m_thresh, m_maxval, m_type);
+		Types::parallelRows(img.rows, m_threads, boost::bind(&CvThreshold_Processor::thresholdRows, this, _1, boost::cref(img), boost::ref(out)));
+		probe.bytesOut(out);
 		out_img.write(out);
 	} catch (...) {
 		LOG(LERROR) << "CvThreshold::onNewImage failed\n";
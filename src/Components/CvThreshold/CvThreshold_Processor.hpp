@@ -58,6 +58,8 @@
  * Maximum value to use with THRESH_BINARY and THRESH_BINARY_INV thresholding types
  * \prop{thresh,double,0.5}
  * Threshold value
+ * \prop{threads,int,1}
+ * Number of threads processing bands of rows (0 - all cores)
  *
  * \see http://opencv.willowgarage.com/documentation/cpp/miscellaneous_image_transformations.html#threshold
  * @{
@@ -162,6 +164,9 @@ protected:
 	 */
 	void onNewImage();
 
+	/// Thresholds given rows of the image.
+	void thresholdRows(const cv::Range & rows, const cv::Mat & img, cv::Mat & out);
+
 	/// Input data stream
 	Base::DataStreamIn <cv::Mat> in_img;
 
@@ -174,6 +179,9 @@ private:
 
 	Base::Property<double> m_thresh;
 	Base::Property<double> m_maxval;
+
+	/// Number of threads processing bands of rows.
+	Base::Property<int> m_threads;
 };
 
 }//: namespace CvThreshold
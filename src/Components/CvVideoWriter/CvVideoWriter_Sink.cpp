@@ -13,6 +13,13 @@
 #include "Logger.hpp"
 #include "Types/Drawable.hpp"
 
+#include <cstdio>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
 namespace Sinks {
 namespace CvVideoWriter {
 
@@ -21,7 +28,11 @@ CvVideoWriter_Sink::CvVideoWriter_Sink(const std::string & name) : Base::Compone
 		fourcc("fourcc", CV_FOURCC_DEFAULT),
 		width("width", 640),
 		height("height", 480),
-		fps("fps", 25)
+		fps("fps", 25),
+		queue_size("queue.size", 32),
+		queue_overflow("queue.overflow", std::string("block")),
+		segment_frames("segment.frames", 0),
+		segment_minutes("segment.minutes", 0)
 {
 	LOG(LTRACE)<<"Hello CvVideoWriter_Sink\n";
 
@@ -36,6 +47,12 @@ CvVideoWriter_Sink::CvVideoWriter_Sink(const std::string & name) : Base::Compone
 	registerProperty(filename);
 	registerProperty(fourcc);
 	registerProperty(fps);
+	registerProperty(queue_size);
+	registerProperty(queue_overflow);
+	registerProperty(segment_frames);
+	registerProperty(segment_minutes);
+
+	stopping = false;
 }
 
 CvVideoWriter_Sink::~CvVideoWriter_Sink() {
@@ -52,19 +69,42 @@ void CvVideoWriter_Sink::prepareInterface() {
 bool CvVideoWriter_Sink::onInit() {
 	LOG(LTRACE) << "CvVideoWriter_Sink::initialize\n";
 
-	writer.open(filename, fourcc, fps, cv::Size(width, height));
+	frame_size = cv::Size(width, height);
+	segment = 0;
+	segment_count = 0;
+	written = dropped = adapted = 0;
+	capacity = std::max((int)queue_size, 1);
+	failed = false;
 
-	if (writer.isOpened())
-		LOG(LTRACE) << "CameraOpenCV: device opened\n";
-	else
-		LOG(LWARNING) << "CameraOpenCV: device NOT opened!\n";
+	// With the size given, movie is opened right away, otherwise by the encoder,
+	// when the first frame arrives.
+	if (frame_size.width > 0 && frame_size.height > 0 && !openSegment(frame_size))
+		return false;
 
-	return writer.isOpened();
+	stopping = false;
+	encoder.reset(new boost::thread(boost::bind(&CvVideoWriter_Sink::encode, this)));
+
+	return true;
 }
 
 bool CvVideoWriter_Sink::onFinish() {
 	LOG(LTRACE) << "CvVideoWriter_Sink::finish\n";
 
+	// Queued frames are written before closing the file.
+	if (encoder) {
+		{
+			boost::mutex::scoped_lock lock(queue_mutex);
+			stopping = true;
+		}
+		queue_cond.notify_all();
+		encoder->join();
+		encoder.reset();
+	}
+	writer.release();
+
+	LOG(LINFO) << "CvVideoWriter: " << written << " frames written in " << segment << " files, "
+			<< dropped << " dropped, " << adapted << " converted";
+
 	return true;
 }
 
@@ -82,15 +122,144 @@ void CvVideoWriter_Sink::onNewImage() {
 	LOG(LTRACE)<<"CvVideoWriter_Sink::onNewImage\n";
 
 	try {
+		// Producer may overwrite its buffer in the next step.
 		cv::Mat img = in_img.read().clone();
 
-		writer << img;
+		boost::mutex::scoped_lock lock(queue_mutex);
+		if (failed) {
+			++dropped;
+			return;
+		}
+		if ((int)queue.size() >= capacity) {
+			std::string policy = queue_overflow;
+			if (policy == "drop_newest") {
+				++dropped;
+				return;
+			} else if (policy == "drop_oldest") {
+				queue.pop_front();
+				++dropped;
+			} else {
+				while ((int)queue.size() >= capacity && encoder)
+					queue_cond.wait(lock);
+			}
+		}
+		queue.push_back(img);
+		queue_cond.notify_all();
 	}
 	catch(...) {
 		LOG(LERROR) << "CvVideoWriter::onNewImage failed\n";
 	}
 }
 
+void CvVideoWriter_Sink::encode() {
+	for (;;) {
+		cv::Mat img;
+		{
+			boost::mutex::scoped_lock lock(queue_mutex);
+			while (queue.empty() && !stopping)
+				queue_cond.wait(lock);
+			if (queue.empty())
+				return;
+			img = queue.front();
+			queue.pop_front();
+			queue_cond.notify_all();
+			if (failed) {
+				++dropped;
+				continue;
+			}
+		}
+
+		try {
+			if (frame_size.width <= 0 || frame_size.height <= 0)
+				frame_size = img.size();
+
+			// Start new segment, if the current one is long enough.
+			bool next = !writer.isOpened();
+			if (segment_frames > 0 && segment_count >= segment_frames)
+				next = true;
+			if (segment_minutes > 0 && segment_count > 0 &&
+					(boost::posix_time::microsec_clock::universal_time() - segment_start).total_milliseconds() >= segment_minutes * 60000)
+				next = true;
+			if (next && !openSegment(frame_size)) {
+				// Writing stops, instead of creating new segment for every frame.
+				boost::mutex::scoped_lock lock(queue_mutex);
+				LOG(LERROR) << "CvVideoWriter: writing stopped, remaining frames are dropped";
+				failed = true;
+				dropped += queue.size() + 1;
+				queue.clear();
+				queue_cond.notify_all();
+				continue;
+			}
+
+			writer << adapt(img);
+			++segment_count;
+			++written;
+		}
+		catch(...) {
+			LOG(LERROR) << "CvVideoWriter: encoding of frame failed\n";
+		}
+	}
+}
+
+cv::Mat CvVideoWriter_Sink::adapt(const cv::Mat & img) {
+	cv::Mat out = img;
+	if (out.depth() == CV_8U && out.channels() == 3 && out.size() == frame_size)
+		return out;
+
+	if (adapted++ == 0) {
+		LOG(LWARNING) << "CvVideoWriter: frames (" << img.cols << "x" << img.rows << ", type " << img.type()
+				<< ") converted to " << frame_size.width << "x" << frame_size.height << " BGR";
+	}
+
+	if (out.depth() != CV_8U) {
+		cv::Mat tmp;
+		double scale = (out.depth() == CV_32F || out.depth() == CV_64F) ? 255.0 : 1.0 / 256;
+		out.convertTo(tmp, CV_8U, scale);
+		out = tmp;
+	}
+
+	if (out.channels() != 3) {
+		cv::Mat tmp;
+		cv::cvtColor(out, tmp, out.channels() == 4 ? CV_BGRA2BGR : CV_GRAY2BGR);
+		out = tmp;
+	}
+
+	if (out.size() != frame_size) {
+		cv::Mat tmp;
+		cv::resize(out, tmp, frame_size);
+		out = tmp;
+	}
+
+	return out;
+}
+
+bool CvVideoWriter_Sink::openSegment(cv::Size size) {
+	std::string fname = filename;
+
+	// Segments are numbered, single file keeps its name.
+	if (segment_frames > 0 || segment_minutes > 0) {
+		char num[16];
+		std::sprintf(num, "_%03d", segment);
+		size_t dot = fname.rfind('.');
+		if (dot == std::string::npos || fname.find('/', dot) != std::string::npos)
+			dot = fname.size();
+		fname.insert(dot, num);
+	}
+
+	writer.release();
+	writer.open(fname, fourcc, fps, size);
+	++segment;
+	segment_count = 0;
+	segment_start = boost::posix_time::microsec_clock::universal_time();
+
+	if (writer.isOpened())
+		LOG(LINFO) << "CvVideoWriter: writing to " << fname;
+	else
+		LOG(LERROR) << "CvVideoWriter: couldn't open " << fname;
+
+	return writer.isOpened();
+}
+
 
 }//: namespace CvVideoWriter
 }//: namespace Sinks
@@ -18,12 +18,29 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 /**
  * \defgroup CvVideoWriter CvVideoWriter
  * \ingroup Sinks
  *
  * Writes all frames into movie file.
  *
+ * Frames are encoded by separate thread, so encoding doesn't delay the processing -
+ * handler only puts the frame into bounded queue. Movie file is created at
+ * initialization (or when the first frame arrives, if the size isn't given). If the
+ * file can't be created, initialization fails or, for later segments, writing stops. Frames of different size are resized to the size of the movie
+ * and converted to 8-bit, 3-channel images, as expected by the encoders.
+ *
+ * Long recordings can be split into segments - then the number of the segment
+ * is appended to the file name (e.g. output_000.avi, output_001.avi, ...).
+ *
  *
  *
  * \par Data streams:
@@ -44,10 +61,20 @@
  * Output file name
  * \prop{fourcc,string,"MJPG"}
  * Codec FOURCC code
- * \prop{size,cv::Size,640 480}
- * Movie frame size
+ * \prop{width,int,640}
+ * Movie frame width, 0 - width of the first frame
+ * \prop{height,int,480}
+ * Movie frame height, 0 - height of the first frame
  * \prop{fps,double,25.0}
  * Movie frame rate
+ * \prop{queue.size,int,32}
+ * Maximum number of frames waiting for the encoder (at least 1)
+ * \prop{queue.overflow,string,"block"}
+ * What to do when the queue is full: "block" (wait), "drop_oldest" or "drop_newest"
+ * \prop{segment.frames,int,0}
+ * Number of frames in single file, 0 - no limit
+ * \prop{segment.minutes,double,0}
+ * Length of single file in minutes (of recording time), 0 - no limit
  *
  *
  * \see http://opencv.willowgarage.com/documentation/cpp/reading_and_writing_images_and_video.html#VideoWriter
@@ -173,6 +200,67 @@ protected:
 	Base::Property<int> height;
 	Base::Property<double> fps;
 
+	/// Maximum number of queued frames.
+	Base::Property<int> queue_size;
+
+	/// Queue overflow policy.
+	Base::Property<std::string> queue_overflow;
+
+	/// Number of frames in single file.
+	Base::Property<int> segment_frames;
+
+	/// Length of single file.
+	Base::Property<double> segment_minutes;
+
+	/// Encoder thread body.
+	void encode();
+
+	/*!
+	 * Converts frame to the size and type accepted by the writer.
+	 */
+	cv::Mat adapt(const cv::Mat & img);
+
+	/*!
+	 * Opens next movie file (segment).
+	 */
+	bool openSegment(cv::Size size);
+
+	/// Encoder thread.
+	boost::shared_ptr<boost::thread> encoder;
+
+	/// Frames waiting for the encoder.
+	std::deque<cv::Mat> queue;
+
+	/// Protects the queue.
+	boost::mutex queue_mutex;
+
+	/// Signalled when frame is queued or taken.
+	boost::condition_variable queue_cond;
+
+	/// Set when encoder should finish (after writing queued frames).
+	bool stopping;
+
+	/// Maximum number of queued frames (at least one).
+	int capacity;
+
+	/// Set when movie file couldn't be opened, frames are dropped since then.
+	bool failed;
+
+	/// Size of the movie frames.
+	cv::Size frame_size;
+
+	/// Number of the current segment.
+	int segment;
+
+	/// Number of frames in the current segment.
+	int segment_count;
+
+	/// Time when the current segment was opened.
+	boost::posix_time::ptime segment_start;
+
+	unsigned long written;
+	unsigned long dropped;
+	unsigned long adapted;
 };
 
 }//: namespace CvVideoWriter
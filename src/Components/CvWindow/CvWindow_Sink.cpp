@@ -18,16 +18,21 @@
 
 #include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 namespace Sinks {
 namespace CvWindow {
 
 CvWindow_Sink::CvWindow_Sink(const std::string & name) :
-	Base::Component(name), title("title", boost::bind(
+	Base::Component(name), display_max_size("display.max_size", 0), title("title", boost::bind(
 			&CvWindow_Sink::onTitleChanged, this, _1, _2), name), dir(
 			"save.directory", boost::bind(&CvWindow_Sink::onDirChanged, this, _1, _2), "./"),
 			filename("save.filename", boost::bind(&CvWindow_Sink::onFilenameChanged, this, _1, _2), name),
 			count("count", 1),
+			save_format("save.format", std::string("png")),
+			save_png_compression("save.png_compression", 0),
+			save_jpeg_quality("save.jpeg_quality", -1),
+			save_fast_lossless("save.fast_lossless", false),
 			mouse_tracking("mouse.tracking", false)
 {
 	CLOG(LTRACE) << "Hello CvWindow_Sink\n";
@@ -38,6 +43,11 @@ CvWindow_Sink::CvWindow_Sink(const std::string & name) :
 	registerProperty(count);
 	registerProperty( filename);
 	registerProperty( dir);
+	registerProperty(save_format);
+	registerProperty(save_png_compression);
+	registerProperty(save_jpeg_quality);
+	registerProperty(save_fast_lossless);
+	registerProperty(display_max_size);
 
 	firststep = true;
 }
@@ -104,6 +114,11 @@ void CvWindow_Sink::prepareInterface() {
 
 
 	img.resize(count);
+	fresh.resize(count, false);
+	overlays.resize(count);
+	displays.resize(count);
+	display_scales.resize(count, 1.0);
+	save_containers.resize(count);
 	to_draw.resize(count);
 	for (int i =0; i < count; ++i) {
 		to_draw_timeout.push_back(0);
@@ -146,6 +161,13 @@ bool CvWindow_Sink::onFinish() {
 	}
 #endif
 
+	for (size_t i = 0; i < save_containers.size(); ++i) {
+		if (save_containers[i]) {
+			save_containers[i]->close();
+			save_containers[i].reset();
+		}
+	}
+
 	return true;
 }
 
@@ -167,53 +189,95 @@ void CvWindow_Sink::onNewImageN(int n) {
 	CLOG(LTRACE) << name() << "::onNewImage(" << n << ")";
 
 	try {
+		boost::mutex::scoped_lock lock(img_mutex);
+
+		// Only the reference is kept, image is composed when (and if) it's displayed.
 		if (!in_img[n]->empty()) {
-			img[n] = in_img[n]->read().clone();
+			img[n] = in_img[n]->read();
+			fresh[n] = true;
 		}
 
 		if (to_draw_timeout[n])
 			--to_draw_timeout[n];
 
-		Types::DrawableContainer ctr;
-		while (!in_draw[n]->empty()) {
-			ctr.add(in_draw[n]->read()->clone());
-			to_draw[n] = boost::shared_ptr<Types::Drawable>(ctr.clone());
-			to_draw_timeout[n] = 10;
-		}
-
-		if (to_draw[n]) {
-			float opacity = 0.1 * to_draw_timeout[n];
-			if (opacity > 0.01) {
-				cv::Mat overlay;
-				img[n].copyTo(overlay);
-				to_draw[n]->draw(overlay, CV_RGB(255,0,255));
-				cv::addWeighted(overlay, opacity, img[n], 1-opacity, 0, img[n]);
-			}
-		}
-
-		// Display image.
-		//onStep();
+		readDrawables(n);
 	} catch (std::exception &ex) {
 		CLOG(LERROR) << "CvWindow::onNewImage failed: " << ex.what() << "";
 	}
 }
 
+bool CvWindow_Sink::readDrawables(int n) {
+	if (in_draw[n]->empty())
+		return false;
+
+	Types::DrawableContainer ctr;
+	while (!in_draw[n]->empty())
+		ctr.add(in_draw[n]->read()->clone());
+	to_draw[n] = boost::shared_ptr<Types::Drawable>(ctr.clone());
+	to_draw_timeout[n] = 10;
+	return true;
+}
+
+cv::Mat CvWindow_Sink::compose(int n, cv::Mat & buffer) {
+	cv::Mat image;
+	boost::shared_ptr<Types::Drawable> drawable;
+	float opacity;
+	{
+		boost::mutex::scoped_lock lock(img_mutex);
+		image = img[n];
+		drawable = to_draw[n];
+		opacity = 0.1 * to_draw_timeout[n];
+	}
+
+	if (!drawable || opacity <= 0.01 || image.empty())
+		return image;
+
+	image.copyTo(buffer);
+	drawable->draw(buffer, CV_RGB(255,0,255));
+	cv::addWeighted(buffer, opacity, image, 1-opacity, 0, buffer);
+	return buffer;
+}
+
 void CvWindow_Sink::onRefresh() {
 	CLOG(LTRACE) << "CvWindow_Sink::step";
 
 	try {
 		for (int i = 0; i < count; ++i) {
-			char id = '0' + i;
+			bool is_new;
+			bool empty;
+			{
+				boost::mutex::scoped_lock lock(img_mutex);
+				// Drawables may arrive after the image they belong to.
+				is_new = readDrawables(i) || fresh[i];
+				empty = img[i].empty();
+				fresh[i] = false;
+			}
 
-			if (img[i].empty()) {
+			if (empty) {
 				CLOG(LWARNING) << name() << ": image " << i << " empty";
-			} else {
-				// Refresh image.
-				imshow(titles[i], img[i]);
-				waitKey(2);
+				continue;
+			}
+
+			// Window already shows this image, with this overlay.
+			if (!is_new)
+				continue;
+
+			cv::Mat shown = compose(i, overlays[i]);
+
+			display_scales[i] = 1.0;
+			int longest = std::max(shown.cols, shown.rows);
+			if (display_max_size > 0 && longest > display_max_size) {
+				display_scales[i] = (double)display_max_size / longest;
+				cv::resize(shown, displays[i], cv::Size(), display_scales[i], display_scales[i], cv::INTER_AREA);
+				shown = displays[i];
 			}
+
+			// Refresh image.
+			imshow(titles[i], shown);
 		}
 
+		waitKey(2);
+
 	} catch (...) {
 		CLOG(LERROR) << "CvWindow::onStep failed\n";
 	}
@@ -240,7 +304,6 @@ void CvWindow_Sink::onSaveImageN(int n) {
 	CLOG(LTRACE) << name() << "::onSaveImageN(" << n << ")";
 
 	try {
-		char id = '0' + n;
 		std::time_t rawtime;
 		std::tm* timeinfo;
 		char buffer [80];
@@ -251,14 +314,7 @@ void CvWindow_Sink::onSaveImageN(int n) {
 		std::strftime(buffer,80,"%Y-%m-%d-%H-%M-%S",timeinfo);
 
 		if(!in_save[n]->empty()) in_save[n]->read();
-		// Change compression to lowest.
-	        vector<int> param;
-	        param.push_back(CV_IMWRITE_PNG_COMPRESSION);
-	        param.push_back(0); // MAX_MEM_LEVEL = 9 
-		// Save image.
-		std::string tmp_name = std::string(dir) + std::string("/") + std::string(filename) + id + "_" + buffer + std::string(".png");
-		imwrite(tmp_name, img[n], param);
-		CLOG(LINFO) << "Window " << name() << " saved to file " << tmp_name <<std::endl;
+		saveImage(n, buffer);
 
 	} catch (std::exception &ex) {
 		CLOG(LERROR) << "CvWindow::onSaveImageN failed: " << ex.what() << "\n";
@@ -277,22 +333,18 @@ void CvWindow_Sink::onSaveAllImages() {
 
 	std::strftime(buffer,80,"%Y-%m-%d-%H-%M-%S",timeinfo);
 
-	// Change compression to lowest.
-        vector<int> param;
-	param.push_back(CV_IMWRITE_PNG_COMPRESSION);
-	param.push_back(0); // MAX_MEM_LEVEL = 9 
-
 	try {
 		for (int i = 0; i < count; ++i) {
-			char id = '0' + i;
+			bool empty;
+			{
+				boost::mutex::scoped_lock lock(img_mutex);
+				empty = img[i].empty();
+			}
 
-			if (img[i].empty()) {
+			if (empty) {
 				LOG(LWARNING) << name() << ": image " << i << " empty";
 			} else {
-				// Save image.
-				std::string tmp_name = std::string(dir) + std::string("/") + std::string(filename) + id + "_" + buffer + std::string(".png");
-				imwrite(tmp_name, img[i], param);
-				CLOG(LINFO) << "Window " << name() << " saved to file " << tmp_name <<std::endl;
+				saveImage(i, buffer);
 			}
 		}
 	} catch (std::exception &ex) {
@@ -300,6 +352,42 @@ void CvWindow_Sink::onSaveAllImages() {
 	}
 }
 
+void CvWindow_Sink::saveImage(int n, const std::string & stamp) {
+	char id = '0' + n;
+
+	Types::EncoderSettings enc;
+	enc.png_compression = save_png_compression;
+	enc.jpeg_quality = save_jpeg_quality;
+	enc.fast_lossless = save_fast_lossless;
+
+	// Save image.
+	std::string format = save_format;
+	std::string tmp_name = std::string(dir) + std::string("/") + std::string(filename) + id + "_" + stamp + "." + format;
+	std::string target = tmp_name;
+	bool saved;
+	{
+		// Image is saved as displayed - with the overlay.
+		cv::Mat buffer;
+		cv::Mat image = compose(n, buffer);
+		Types::EncodeTimer timer(encode_stats, image);
+		if (!save_containers[n])
+			save_containers[n].reset(new Types::FrameContainerWriter);
+		saved = Types::writeImage(tmp_name, format, image, enc, save_containers[n].get());
+
+		// In fast lossless mode image is appended to the container of the window.
+		const Types::FrameContainerWriter & container = *save_containers[n];
+		if (saved && enc.useFastLossless(image))
+			target = container.fileName() + " (frame " + boost::lexical_cast<std::string>(container.size() - 1) + ")";
+	}
+
+	if (!saved) {
+		CLOG(LERROR) << "Window " << name() << " couldn't save image to " << target;
+		return;
+	}
+	CLOG(LINFO) << "Window " << name() << " saved to " << target << " (avg. " << encode_stats.averageMs()
+			<< " ms per image)" << std::endl;
+}
+
 void CvWindow_Sink::onFilenameChanged(const std::string & old_filename,
 		const std::string & new_filename) {
 	filename = new_filename;
@@ -320,6 +408,9 @@ void CvWindow_Sink::onMouseStatic(int event, int x, int y, int flags, void * use
 	
 void CvWindow_Sink::onMouse(int event, int x, int y, int flags, int window) {
 	if (event != 0 || mouse_tracking) {
+		// Position in the original (not downscaled) image.
+		x = x / display_scales[window];
+		y = y / display_scales[window];
 		CLOG(LNOTICE) << "Click in " << titles[window] << " at " << x << "," << y << " [" << event << "]";
 		if(event ==1 ) out_point[window]->write(cv::Point(x, y));
 	}
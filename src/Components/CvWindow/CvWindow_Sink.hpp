@@ -18,6 +18,11 @@
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Types/ImageEncoding.hpp"
+
+#include <boost/thread/mutex.hpp>
 
 /**
  * \defgroup CvWindow CvWindow
@@ -27,6 +32,10 @@
  * information on top of displayed image by using in_draw stream (and feeding it
  * with \ref Types::Drawable "drawable" items).
  *
+ * Incoming images are not copied - only the newest one is kept, and it is composed
+ * with the overlay (and downscaled, if requested) in onRefresh, and only if it or the
+ * overlay has changed since it was displayed.
+ *
  *
  *
  * \par Data streams:
@@ -47,6 +56,18 @@
  *
  * \prop{title,string,"video"}
  * Window caption
+ * \prop{display.max_size,int,0}
+ * If set, images with longer side exceeding given size are downscaled for display
+ * (mouse positions are still reported in the coordinates of the original image)
+ * \prop{save.format,string,"png"}
+ * Format of saved images
+ * \prop{save.png_compression,int,0}
+ * PNG compression level of saved images
+ * \prop{save.jpeg_quality,int,-1}
+ * JPEG quality of saved images, -1 - OpenCV default
+ * \prop{save.fast_lossless,bool,false}
+ * If set, images deeper than 8 bits are saved uncompressed, appended to one cvraw file per window
+ * (named after the first of them, closed when the component finishes)
  *
  *
  * \see http://opencv.willowgarage.com/documentation/cpp/user_interface.html#namedWindow
@@ -155,6 +176,25 @@ protected:
 	 * Event handler function - for saving of all images.
 	 */
 	void onSaveAllImages();
+
+	/*!
+	 * Saves n-th image, file name is suffixed with given time stamp.
+	 */
+	void saveImage(int n, const std::string & stamp);
+
+	/*!
+	 * Returns n-th image blended with the overlay. Composed image is stored in given buffer,
+	 * if there is no overlay, image itself is returned.
+	 */
+	cv::Mat compose(int n, cv::Mat & buffer);
+
+	/*!
+	 * Takes drawables waiting in n-th stream (img_mutex has to be locked).
+	 *
+	 * \return true if the overlay has changed
+	 */
+	bool readDrawables(int n);
+
 	/*!
 	 * Event handler function.
 	 */
@@ -197,6 +237,24 @@ protected:
 	/// Image to be drawn.
 	std::vector<cv::Mat> img;
 
+	/// Set if the image (or its overlay) wasn't displayed yet.
+	std::vector<bool> fresh;
+
+	/// Buffers for images composed with overlay.
+	std::vector<cv::Mat> overlays;
+
+	/// Buffers for downscaled images.
+	std::vector<cv::Mat> displays;
+
+	/// Scale of displayed images.
+	std::vector<double> display_scales;
+
+	/// Maximum size of displayed image.
+	Base::Property<int> display_max_size;
+
+	/// Protects images and overlays, which are received and displayed by different handlers.
+	boost::mutex img_mutex;
+
 	std::vector<boost::shared_ptr<Types::Drawable> > to_draw;
 	std::vector<int> to_draw_timeout;
 
@@ -209,6 +267,17 @@ protected:
 
 	Base::Property<std::string> filename;
 	Base::Property<std::string> dir;
+
+	Base::Property<std::string> save_format;
+	Base::Property<int> save_png_compression;
+	Base::Property<int> save_jpeg_quality;
+	Base::Property<bool> save_fast_lossless;
+
+	/// Containers of deep images saved in fast lossless mode, opened on first use.
+	std::vector<boost::shared_ptr<Types::FrameContainerWriter> > save_containers;
+
+	/// Time of saving images.
+	Types::EncodeStats encode_stats;
 	
 	
 	std::vector<MouseCallbackInfo*> callback_info;
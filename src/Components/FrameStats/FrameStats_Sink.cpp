@@ -0,0 +1,205 @@
+/*!
+ * \file FrameStats_Sink.cpp
+ * \brief Headless sink collecting timing statistics of image streams
+ */
+
+#include "FrameStats_Sink.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace Sinks {
+namespace FrameStats {
+
+FrameStats_Sink::FrameStats_Sink(const std::string & name) :
+	Base::Component(name),
+	last_report(0),
+	header_written(false),
+	count("count", 1),
+	prop_checksum("checksum", false),
+	report_file("report.file", std::string("")),
+	report_format("report.format", std::string("csv")),
+	report_interval("report.interval", 1.0)
+{
+	count.setToolTip("Number of input streams");
+	registerProperty(count);
+	registerProperty(prop_checksum);
+	registerProperty(report_file);
+	registerProperty(report_format);
+	registerProperty(report_interval);
+}
+
+FrameStats_Sink::~FrameStats_Sink() {
+	for (size_t i = 0; i < in_img.size(); ++i) {
+		delete in_img[i];
+		delete in_timestamp[i];
+	}
+	for (size_t i = 0; i < handlers.size(); ++i)
+		delete handlers[i];
+}
+
+void FrameStats_Sink::prepareInterface() {
+	for (int i = 0; i < count; ++i) {
+		char id = '0' + i;
+
+		in_img.push_back(new Base::DataStreamIn<cv::Mat, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex>);
+		registerStream(std::string("in_img") + id, in_img[i]);
+
+		in_timestamp.push_back(new Base::DataStreamIn<double, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex>);
+		registerStream(std::string("in_timestamp") + id, in_timestamp[i]);
+
+		Base::EventHandler2 * hand = new Base::EventHandler2;
+		hand->setup(boost::bind(&FrameStats_Sink::onNewImageN, this, i));
+		handlers.push_back(hand);
+		registerHandler(std::string("onNewImage") + id, hand);
+		addDependency(std::string("onNewImage") + id, in_img[i]);
+	}
+
+	// Aliases for the first stream.
+	registerStream("in_img", in_img[0]);
+	registerStream("in_timestamp", in_timestamp[0]);
+
+	stats.resize(count);
+}
+
+bool FrameStats_Sink::onInit() {
+	return true;
+}
+
+bool FrameStats_Sink::onFinish() {
+	boost::mutex::scoped_lock lock(stats_mutex);
+	report(now(), true);
+	return true;
+}
+
+bool FrameStats_Sink::onStart() {
+	boost::mutex::scoped_lock lock(stats_mutex);
+	double t = now();
+	for (size_t i = 0; i < stats.size(); ++i)
+		stats[i].reset(t);
+	last_report = t;
+	header_written = false;
+	return true;
+}
+
+bool FrameStats_Sink::onStop() {
+	return true;
+}
+
+void FrameStats_Sink::onNewImageN(int n) {
+	double arrival = now();
+
+	cv::Mat img = in_img[n]->read();
+
+	double latency = -1;
+	if (!in_timestamp[n]->empty())
+		latency = arrival - in_timestamp[n]->read();
+
+	// Checksum is computed outside of the lock, other streams don't wait for it.
+	boost::uint32_t sum = prop_checksum ? StreamStats::checksum(img) : 0;
+
+	boost::mutex::scoped_lock lock(stats_mutex);
+	stats[n].add(arrival, latency, sum);
+
+	if (report_interval > 0 && arrival - last_report >= report_interval) {
+		report(arrival, false);
+		last_report = arrival;
+	}
+}
+
+void FrameStats_Sink::report(double now, bool final) {
+	std::string scope = final ? "total" : "window";
+
+	std::vector<StatsSummary> summaries;
+	for (size_t i = 0; i < stats.size(); ++i) {
+		StatsSummary s = final ? stats[i].total() : stats[i].window(now);
+		summaries.push_back(s);
+
+		std::ostringstream msg;
+		msg << std::fixed << std::setprecision(2) << name() << ": stream " << i << " [" << scope << "] "
+				<< s.frames << " frames, " << s.fps << " fps, interval " << s.interval << " ms, jitter " << s.jitter << " ms";
+		if (s.has_latency)
+			msg << ", latency p50/p90/p99/max " << s.latency_p50 << "/" << s.latency_p90 << "/"
+					<< s.latency_p99 << "/" << s.latency_max << " ms";
+		if (prop_checksum)
+			msg << ", checksum " << std::hex << s.checksum << ", digest " << s.digest;
+
+		if (final) {
+			CLOG(LNOTICE) << msg.str();
+		} else {
+			CLOG(LINFO) << msg.str();
+		}
+	}
+
+	if (std::string(report_file).empty())
+		return;
+
+	if (std::string(report_format) == "json") {
+		writeJson(now, scope, summaries);
+	} else {
+		for (size_t i = 0; i < summaries.size(); ++i)
+			writeCsv(now, i, scope, summaries[i]);
+	}
+}
+
+void FrameStats_Sink::writeCsv(double now, int n, const std::string & scope, const StatsSummary & s) {
+	std::ofstream out(std::string(report_file).c_str(), header_written ? std::ios::app : std::ios::trunc);
+	if (!out) {
+		CLOG(LWARNING) << name() << ": can't write report " << std::string(report_file);
+		return;
+	}
+
+	if (!header_written) {
+		out << "time,stream,scope,frames,fps,interval_ms,jitter_ms,"
+				"latency_p50_ms,latency_p90_ms,latency_p99_ms,latency_max_ms,checksum,digest\n";
+		header_written = true;
+	}
+
+	out << std::fixed << std::setprecision(6) << now << "," << n << "," << scope << "," << s.frames << ","
+			<< std::setprecision(3) << s.fps << "," << s.interval << "," << s.jitter << ",";
+	// Latencies are left empty if stream has no timestamps.
+	if (s.has_latency)
+		out << s.latency_p50 << "," << s.latency_p90 << "," << s.latency_p99 << "," << s.latency_max << ",";
+	else
+		out << ",,,,";
+	if (prop_checksum)
+		out << std::hex << s.checksum << "," << s.digest << std::dec;
+	else
+		out << ",";
+	out << "\n";
+}
+
+void FrameStats_Sink::writeJson(double now, const std::string & scope, const std::vector<StatsSummary> & s) {
+	std::ofstream out(std::string(report_file).c_str(), std::ios::trunc);
+	if (!out) {
+		CLOG(LWARNING) << name() << ": can't write report " << std::string(report_file);
+		return;
+	}
+
+	out << std::fixed << std::setprecision(6) << "{\n  \"time\": " << now << ",\n  \"scope\": \"" << scope << "\",\n  \"streams\": [\n";
+	out << std::setprecision(3);
+	for (size_t i = 0; i < s.size(); ++i) {
+		out << "    {\"stream\": " << i << ", \"frames\": " << s[i].frames << ", \"fps\": " << s[i].fps
+				<< ", \"interval_ms\": " << s[i].interval << ", \"jitter_ms\": " << s[i].jitter;
+		if (s[i].has_latency)
+			out << ", \"latency_ms\": {\"p50\": " << s[i].latency_p50 << ", \"p90\": " << s[i].latency_p90
+					<< ", \"p99\": " << s[i].latency_p99 << ", \"max\": " << s[i].latency_max << "}";
+		if (prop_checksum)
+			out << ", \"checksum\": " << s[i].checksum << ", \"digest\": " << s[i].digest;
+		out << "}" << (i + 1 < s.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+double FrameStats_Sink::now() {
+	boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+	return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds() / 1e6;
+}
+
+}//: namespace FrameStats
+}//: namespace Sinks
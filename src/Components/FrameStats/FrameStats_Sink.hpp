@@ -0,0 +1,172 @@
+/*!
+ * \file FrameStats_Sink.hpp
+ * \brief Headless sink collecting timing statistics of image streams
+ */
+
+#ifndef FRAMESTATS_SINK_HPP_
+#define FRAMESTATS_SINK_HPP_
+
+#include "Component_Aux.hpp"
+#include "Component.hpp"
+#include "DataStream.hpp"
+#include "Property.hpp"
+#include "EventHandler2.hpp"
+
+#include "StreamStats.hpp"
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * \defgroup FrameStats FrameStats
+ * \ingroup Sinks
+ *
+ * Consumes images without displaying them and reports statistics of their arrival:
+ * frame rate, inter-arrival time and its jitter (standard deviation), latency percentiles
+ * and, optionally, checksums of image content. Can replace CvWindow in benchmarks
+ * run on machines without display.
+ *
+ * Latency is measured only for streams which have connected timestamp
+ * (e.g. out_timestamp of CameraOpenCV or Sequence, in seconds since epoch), which
+ * has to be written before the image.
+ *
+ * Statistics are logged and written to the report file every report.interval seconds
+ * (for that period) and when the component finishes (for the whole run). CSV report has
+ * one row per stream and period, JSON report is rewritten with the newest statistics.
+ *
+ *
+ * \par Data streams:
+ *
+ * \streamin{in_imgN,cv::Mat}
+ * Input images, N = 0..count-1 (in_img is an alias of in_img0)
+ * \streamin{in_timestampN,double}
+ * Source timestamps of the images, in seconds since epoch (in_timestamp is an alias of in_timestamp0)
+ *
+ *
+ * \par Event handlers:
+ *
+ * \handler{onNewImageN}
+ * New image arrived
+ *
+ *
+ * \par Properties:
+ *
+ * \prop{count,int,1}
+ * Number of input streams
+ * \prop{checksum,bool,false}
+ * Compute checksums of images
+ * \prop{report.file,string,""}
+ * Name of the report file, empty - statistics are only logged
+ * \prop{report.format,string,"csv"}
+ * Format of the report - "csv" or "json"
+ * \prop{report.interval,double,1.0}
+ * Period of reports in seconds, 0 - only the final report
+ *
+ * @{
+ *
+ * @}
+ */
+
+namespace Sinks {
+namespace FrameStats {
+
+/*!
+ * \class FrameStats_Sink
+ * \brief Collects timing statistics of image streams.
+ */
+class FrameStats_Sink: public Base::Component {
+public:
+	/*!
+	 * Constructor.
+	 */
+	FrameStats_Sink(const std::string & name = "FrameStats");
+
+	/*!
+	 * Destructor
+	 */
+	virtual ~FrameStats_Sink();
+
+	/*!
+	 * Prepare components interface (register streams and handlers).
+	 */
+	void prepareInterface();
+
+protected:
+
+	/*!
+	 * Connects source to given device.
+	 */
+	bool onInit();
+
+	/*!
+	 * Disconnect source from device, closes streams, etc.
+	 */
+	bool onFinish();
+
+	/*!
+	 * Start component
+	 */
+	bool onStart();
+
+	/*!
+	 * Stop component
+	 */
+	bool onStop();
+
+	/*!
+	 * Event handler function - new image arrived on n-th stream.
+	 */
+	void onNewImageN(int n);
+
+	/// Writes statistics of current window (or the whole run, if final is set) of all streams.
+	void report(double now, bool final);
+
+	/// Appends statistics of single stream to CSV report.
+	void writeCsv(double now, int n, const std::string & scope, const StatsSummary & s);
+
+	/// Writes statistics of all streams to JSON report.
+	void writeJson(double now, const std::string & scope, const std::vector<StatsSummary> & s);
+
+	/// Current time, in seconds since epoch.
+	static double now();
+
+	/// Input images.
+	std::vector<Base::DataStreamIn<cv::Mat, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex> *> in_img;
+
+	/// Input timestamps.
+	std::vector<Base::DataStreamIn<double, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex> *> in_timestamp;
+
+	std::vector<Base::EventHandler2 *> handlers;
+
+	/// Statistics of every stream.
+	std::vector<StreamStats> stats;
+
+	/// Time of the last report.
+	double last_report;
+
+	/// Set if CSV header was already written.
+	bool header_written;
+
+	/// Protects statistics - streams may be handled by different executors.
+	boost::mutex stats_mutex;
+
+	Base::Property<int> count;
+	Base::Property<bool> prop_checksum;
+	Base::Property<std::string> report_file;
+	Base::Property<std::string> report_format;
+	Base::Property<double> report_interval;
+};
+
+}//: namespace FrameStats
+}//: namespace Sinks
+
+/*
+ * Register sink component.
+ */
+REGISTER_COMPONENT("FrameStats", Sinks::FrameStats::FrameStats_Sink)
+
+#endif /* FRAMESTATS_SINK_HPP_ */
@@ -0,0 +1,145 @@
+/*!
+ * \file StreamStats.cpp
+ * \brief Timing statistics of single stream of frames - methods definition.
+ */
+
+#include "StreamStats.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace Sinks {
+namespace FrameStats {
+
+StreamStats::StreamStats() {
+	reset(0);
+}
+
+void StreamStats::reset(double now) {
+	m_frames = 0;
+	m_first = m_last = 0;
+	m_mean = m_m2 = 0;
+	m_latencies.clear();
+	m_checksum = 0;
+	m_digest = 2166136261u;
+
+	m_window_start = now;
+	m_window_frames = 0;
+	m_window_intervals.clear();
+	m_window_latencies.clear();
+}
+
+void StreamStats::add(double arrival, double latency, boost::uint32_t checksum) {
+	if (m_frames == 0) {
+		m_first = arrival;
+	} else {
+		double interval = (arrival - m_last) * 1000;
+		m_window_intervals.push_back(interval);
+
+		unsigned long n = m_frames;
+		double delta = interval - m_mean;
+		m_mean += delta / n;
+		m_m2 += delta * (interval - m_mean);
+	}
+
+	++m_frames;
+	++m_window_frames;
+	m_last = arrival;
+
+	if (latency >= 0) {
+		m_latencies.push_back(latency * 1000);
+		m_window_latencies.push_back(latency * 1000);
+	}
+
+	// FNV-1a like combination - digest depends on the order of frames.
+	m_checksum = checksum;
+	m_digest = (m_digest ^ checksum) * 16777619u;
+}
+
+StatsSummary StreamStats::window(double now) {
+	StatsSummary s;
+	s.frames = m_window_frames;
+	s.fps = (now > m_window_start) ? m_window_frames / (now - m_window_start) : 0;
+
+	s.interval = s.jitter = 0;
+	if (!m_window_intervals.empty()) {
+		double sum = 0, sq = 0;
+		for (size_t i = 0; i < m_window_intervals.size(); ++i)
+			sum += m_window_intervals[i];
+		s.interval = sum / m_window_intervals.size();
+		for (size_t i = 0; i < m_window_intervals.size(); ++i)
+			sq += (m_window_intervals[i] - s.interval) * (m_window_intervals[i] - s.interval);
+		s.jitter = std::sqrt(sq / m_window_intervals.size());
+	}
+
+	latencies(m_window_latencies, s);
+	s.checksum = m_checksum;
+	s.digest = m_digest;
+
+	m_window_start = now;
+	m_window_frames = 0;
+	m_window_intervals.clear();
+	m_window_latencies.clear();
+
+	return s;
+}
+
+StatsSummary StreamStats::total() const {
+	StatsSummary s;
+	s.frames = m_frames;
+	s.fps = (m_frames > 1 && m_last > m_first) ? (m_frames - 1) / (m_last - m_first) : 0;
+	s.interval = m_mean;
+	s.jitter = (m_frames > 1) ? std::sqrt(m_m2 / (m_frames - 1)) : 0;
+	latencies(m_latencies, s);
+	s.checksum = m_checksum;
+	s.digest = m_digest;
+	return s;
+}
+
+void StreamStats::latencies(std::vector<double> values, StatsSummary & s) {
+	s.has_latency = !values.empty();
+	s.latency_p50 = s.latency_p90 = s.latency_p99 = s.latency_max = 0;
+	if (values.empty())
+		return;
+
+	std::sort(values.begin(), values.end());
+	size_t last = values.size() - 1;
+	s.latency_p50 = values[last * 50 / 100];
+	s.latency_p90 = values[last * 90 / 100];
+	s.latency_p99 = values[last * 99 / 100];
+	s.latency_max = values[last];
+}
+
+boost::uint32_t StreamStats::checksum(const cv::Mat & img) {
+	const boost::uint32_t mod = 65521;
+	boost::uint32_t a = 1, b = 0;
+
+	int rows = img.rows;
+	size_t row_bytes = img.cols * img.elemSize();
+	if (img.isContinuous()) {
+		row_bytes *= rows;
+		rows = 1;
+	}
+
+	for (int y = 0; y < rows; ++y) {
+		const uchar * p = img.ptr<uchar>(y);
+		size_t left = row_bytes;
+		while (left > 0) {
+			// Sums can't overflow within 5552 bytes, so the modulo is taken once per block.
+			size_t block = std::min(left, (size_t)5552);
+			for (size_t i = 0; i < block; ++i) {
+				a += p[i];
+				b += a;
+			}
+			a %= mod;
+			b %= mod;
+			p += block;
+			left -= block;
+		}
+	}
+
+	return (b << 16) | a;
+}
+
+}//: namespace FrameStats
+}//: namespace Sinks
@@ -0,0 +1,105 @@
+/*!
+ * \file StreamStats.hpp
+ * \brief Timing statistics of single stream of frames - class declaration.
+ */
+
+#ifndef FRAMESTATS_STREAMSTATS_HPP_
+#define FRAMESTATS_STREAMSTATS_HPP_
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Sinks {
+namespace FrameStats {
+
+/*!
+ * \brief Statistics of the stream over some period of time.
+ *
+ * Times are in milliseconds. Latencies are valid only if has_latency is set.
+ */
+struct StatsSummary {
+	unsigned long frames;
+
+	/// Frames per second.
+	double fps;
+
+	/// Mean time between consecutive frames.
+	double interval;
+
+	/// Standard deviation of the time between consecutive frames.
+	double jitter;
+
+	bool has_latency;
+	double latency_p50;
+	double latency_p90;
+	double latency_p99;
+	double latency_max;
+
+	/// Checksum of the last frame.
+	boost::uint32_t checksum;
+
+	/// Checksum of all frames received so far, in order.
+	boost::uint32_t digest;
+};
+
+/*!
+ * \class StreamStats
+ * \brief Collects arrival times, latencies and checksums of frames of single stream.
+ *
+ * Statistics are gathered both for the whole run and for the current window
+ * (period between consecutive reports). Class isn't thread-safe.
+ */
+class StreamStats {
+public:
+	StreamStats();
+
+	void reset(double now);
+
+	/*!
+	 * Adds frame.
+	 *
+	 * \param arrival time of arrival, in seconds
+	 * \param latency time between the source timestamp and arrival, in seconds, negative if unknown
+	 * \param checksum checksum of the frame
+	 */
+	void add(double arrival, double latency, boost::uint32_t checksum);
+
+	/// Returns statistics of the current window and starts new one.
+	StatsSummary window(double now);
+
+	/// Returns statistics of the whole run.
+	StatsSummary total() const;
+
+	/// Adler-32 checksum of the image content (padding of non-continuous images is skipped).
+	static boost::uint32_t checksum(const cv::Mat & img);
+
+private:
+	/// Fills latency percentiles of the summary.
+	static void latencies(std::vector<double> values, StatsSummary & s);
+
+	unsigned long m_frames;
+	double m_first;
+	double m_last;
+
+	/// Running mean and sum of squared deviations of intervals (Welford's method).
+	double m_mean;
+	double m_m2;
+
+	std::vector<double> m_latencies;
+
+	boost::uint32_t m_checksum;
+	boost::uint32_t m_digest;
+
+	double m_window_start;
+	unsigned long m_window_frames;
+	std::vector<double> m_window_intervals;
+	std::vector<double> m_window_latencies;
+};
+
+}//: namespace FrameStats
+}//: namespace Sinks
+
+#endif /* FRAMESTATS_STREAMSTATS_HPP_ */
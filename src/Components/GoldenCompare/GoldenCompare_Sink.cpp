@@ -0,0 +1,273 @@
+/*!
+ * \file GoldenCompare_Sink.cpp
+ * \brief Compares results of processors with the stored reference (golden) results
+ */
+
+#include "GoldenCompare_Sink.hpp"
+#include "Logger.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+namespace Sinks {
+namespace GoldenCompare {
+
+namespace {
+
+/// Splits comma separated list into count items - single item applies to all.
+std::vector<std::string> splitList(const std::string & list, int count) {
+	std::vector<std::string> items;
+	std::string l = list;
+	boost::split(items, l, boost::is_any_of(","));
+
+	std::vector<std::string> values(count);
+	for (int i = 0; i < count; ++i)
+		values[i] = boost::trim_copy(items.size() == 1 ? items[0] : (i < (int)items.size() ? items[i] : std::string()));
+	return values;
+}
+
+double toDouble(const std::string & s, double def) {
+	try {
+		return s.empty() ? def : boost::lexical_cast<double>(s);
+	} catch (...) {
+		return def;
+	}
+}
+
+}//: namespace
+
+GoldenCompare_Sink::GoldenCompare_Sink(const std::string & name) :
+	Base::Component(name),
+	recording(false),
+	count("count", 1),
+	directory("directory", std::string("golden")),
+	names("names", std::string("")),
+	mode("mode", std::string("compare")),
+	tolerance_max_diff("tolerance.max_diff", std::string("0")),
+	tolerance_fraction("tolerance.fraction", std::string("0")),
+	report_file("report.file", std::string(""))
+{
+	count.setToolTip("Number of checked streams");
+	registerProperty(count);
+	registerProperty(directory);
+	registerProperty(names);
+	mode.setToolTip("compare or record");
+	registerProperty(mode);
+	registerProperty(tolerance_max_diff);
+	registerProperty(tolerance_fraction);
+	registerProperty(report_file);
+}
+
+GoldenCompare_Sink::~GoldenCompare_Sink() {
+	for (size_t i = 0; i < in_img.size(); ++i) {
+		delete in_img[i];
+		delete in_features[i];
+	}
+	for (size_t i = 0; i < handlers.size(); ++i)
+		delete handlers[i];
+}
+
+void GoldenCompare_Sink::prepareInterface() {
+	for (int i = 0; i < count; ++i) {
+		char id = '0' + i;
+
+		in_img.push_back(new Base::DataStreamIn<cv::Mat, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex>);
+		registerStream(std::string("in_img") + id, in_img[i]);
+
+		in_features.push_back(new Base::DataStreamIn<Types::Features, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex>);
+		registerStream(std::string("in_features") + id, in_features[i]);
+
+		Base::EventHandler2 * hand = new Base::EventHandler2;
+		hand->setup(boost::bind(&GoldenCompare_Sink::onNewImageN, this, i));
+		handlers.push_back(hand);
+		registerHandler(std::string("onNewImage") + id, hand);
+		addDependency(std::string("onNewImage") + id, in_img[i]);
+
+		hand = new Base::EventHandler2;
+		hand->setup(boost::bind(&GoldenCompare_Sink::onNewFeaturesN, this, i));
+		handlers.push_back(hand);
+		registerHandler(std::string("onNewFeatures") + id, hand);
+		addDependency(std::string("onNewFeatures") + id, in_features[i]);
+	}
+
+	// Aliases for the first stream.
+	registerStream("in_img", in_img[0]);
+	registerStream("in_features", in_features[0]);
+}
+
+bool GoldenCompare_Sink::onInit() {
+	recording = (std::string(mode) == "record");
+
+	std::vector<std::string> n = splitList(names, count);
+	std::vector<std::string> diffs = splitList(tolerance_max_diff, count);
+	std::vector<std::string> fractions = splitList(tolerance_fraction, count);
+
+	std::string d = directory;
+	boost::filesystem::path dir(d);
+	if (recording && !boost::filesystem::exists(dir))
+		boost::filesystem::create_directories(dir);
+
+	streams.clear();
+	streams.resize(count);
+	for (int i = 0; i < count; ++i) {
+		Stream & s = streams[i];
+		std::string id(1, char('0' + i));
+		if (n[i].empty())
+			s.name = "stream" + id;
+		else if (i > 0 && n[i] == n[0])
+			// Single name given for all streams.
+			s.name = n[i] + id;
+		else
+			s.name = n[i];
+		s.max_diff = toDouble(diffs[i], 0);
+		s.fraction = toDouble(fractions[i], 0);
+		s.frame = 0;
+		s.passed = s.failed = s.missing = 0;
+
+		std::string fname = (dir / (s.name + "." + Types::FrameContainer::Extension)).string();
+		if (recording) {
+			s.recorder.reset(new Types::FrameContainerWriter);
+			if (!s.recorder->open(fname)) {
+				CLOG(LERROR) << name() << ": can't create " << fname;
+				return false;
+			}
+		} else {
+			s.golden.reset(new Types::FrameContainerReader);
+			if (!s.golden->open(fname)) {
+				CLOG(LERROR) << name() << ": can't open golden results " << fname;
+				return false;
+			}
+			CLOG(LINFO) << name() << ": " << s.name << " - " << s.golden->size() << " golden results";
+		}
+	}
+
+	std::string r = report_file;
+	if (!r.empty()) {
+		report.open(r.c_str(), std::ios::trunc);
+		report << "stream,frame,result,max_diff,fraction\n";
+	}
+
+	return true;
+}
+
+bool GoldenCompare_Sink::onFinish() {
+	boost::mutex::scoped_lock lock(streams_mutex);
+
+	for (size_t i = 0; i < streams.size(); ++i) {
+		Stream & s = streams[i];
+		if (recording) {
+			CLOG(LNOTICE) << name() << ": " << s.name << " - " << s.frame << " results recorded";
+			s.recorder.reset();
+		} else {
+			// Golden results never produced in this run - e.g. processor dropped some outputs.
+			if (s.frame < s.golden->size()) {
+				size_t produced = s.frame;
+				s.missing += s.golden->size() - produced;
+				CLOG(LERROR) << name() << ": " << s.name << " - only " << produced << " of " << s.golden->size()
+						<< " golden results produced";
+				if (report.is_open()) {
+					for (size_t frame = produced; frame < s.golden->size(); ++frame)
+						report << s.name << "," << frame << ",not produced,0,0\n";
+				}
+			}
+
+			if (s.failed || s.missing) {
+				CLOG(LERROR) << name() << ": " << s.name << " FAILED - " << s.passed << " passed, " << s.failed
+						<< " failed, " << s.missing << " missing";
+			} else {
+				CLOG(LNOTICE) << name() << ": " << s.name << " passed - " << s.passed << " results checked";
+			}
+			s.golden.reset();
+		}
+	}
+
+	if (report.is_open())
+		report.close();
+
+	return true;
+}
+
+bool GoldenCompare_Sink::onStart() {
+	return true;
+}
+
+bool GoldenCompare_Sink::onStop() {
+	return true;
+}
+
+void GoldenCompare_Sink::onNewImageN(int n) {
+	check(n, in_img[n]->read());
+}
+
+void GoldenCompare_Sink::onNewFeaturesN(int n) {
+	Types::Features f = in_features[n]->read();
+
+	cv::Mat m((int)f.features.size(), 4, CV_32FC1);
+	for (size_t i = 0; i < f.features.size(); ++i) {
+		float * row = m.ptr<float>(i);
+		row[0] = f.features[i].pt.x;
+		row[1] = f.features[i].pt.y;
+		row[2] = f.features[i].size;
+		row[3] = f.features[i].response;
+	}
+
+	check(n, m);
+}
+
+void GoldenCompare_Sink::check(int n, const cv::Mat & result) {
+	boost::mutex::scoped_lock lock(streams_mutex);
+	if (n >= (int)streams.size())
+		return;
+
+	Stream & s = streams[n];
+	size_t frame = s.frame++;
+
+	if (recording) {
+		if (!s.recorder->write(result))
+			CLOG(LERROR) << name() << ": can't record result " << frame << " of " << s.name;
+		return;
+	}
+
+	std::string verdict;
+	double max_diff = 0, fraction = 0;
+
+	cv::Mat golden = s.golden->frame(frame);
+	if (frame >= s.golden->size()) {
+		++s.missing;
+		verdict = "missing";
+		CLOG(LWARNING) << name() << ": no golden result " << frame << " of " << s.name;
+	} else if (golden.size() != result.size() || golden.type() != result.type()) {
+		++s.failed;
+		verdict = "failed";
+		CLOG(LERROR) << name() << ": " << s.name << "[" << frame << "] is " << result.cols << "x" << result.rows
+				<< " (type " << result.type() << "), expected " << golden.cols << "x" << golden.rows
+				<< " (type " << golden.type() << ")";
+	} else {
+		if (!result.empty()) {
+			cv::Mat diff, over;
+			cv::absdiff(result, golden, diff);
+			diff = diff.reshape(1);
+			cv::minMaxLoc(diff, NULL, &max_diff);
+			cv::compare(diff, s.max_diff, over, cv::CMP_GT);
+			fraction = (double)cv::countNonZero(over) / diff.total();
+		}
+
+		if (fraction <= s.fraction) {
+			++s.passed;
+			verdict = "passed";
+		} else {
+			++s.failed;
+			verdict = "failed";
+			CLOG(LERROR) << name() << ": " << s.name << "[" << frame << "] differs - max difference " << max_diff
+					<< ", " << fraction * 100 << "% of elements above tolerance";
+		}
+	}
+
+	if (report.is_open())
+		report << s.name << "," << frame << "," << verdict << "," << max_diff << "," << fraction << "\n";
+}
+
+}//: namespace GoldenCompare
+}//: namespace Sinks
@@ -0,0 +1,198 @@
+/*!
+ * \file GoldenCompare_Sink.hpp
+ * \brief Compares results of processors with the stored reference (golden) results
+ */
+
+#ifndef GOLDENCOMPARE_SINK_HPP_
+#define GOLDENCOMPARE_SINK_HPP_
+
+#include "Component_Aux.hpp"
+#include "Component.hpp"
+#include "DataStream.hpp"
+#include "Property.hpp"
+#include "EventHandler2.hpp"
+
+#include "Types/Features.hpp"
+#include "Types/FrameContainer.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * \defgroup GoldenCompare GoldenCompare
+ * \ingroup Sinks
+ *
+ * Regression check of the processors - compares consecutive results received on
+ * each stream with the golden results, recorded earlier (e.g. before optimizing the processor).
+ *
+ * Golden results of every stream are kept in single \ref Types::FrameContainerWriter "frame container"
+ * (directory/name.cvraw), so the images of any type are stored exactly. In "record" mode
+ * the containers are (re)created from the received results.
+ *
+ * Result matches if it has the same size and type as the golden one, and the fraction
+ * of elements (pixel channels), which differ by more than tolerance.max_diff, doesn't exceed
+ * tolerance.fraction. Features are compared as matrices of (x, y, size, response) rows.
+ *
+ * Results received without the golden one, and golden results never received (counted
+ * on finish), are missing - stream with any missing or mismatched result fails.
+ *
+ * Mismatches are logged as errors, summary is logged on finish. If report.file is set,
+ * result of every comparison is written there (CSV).
+ *
+ *
+ * \par Data streams:
+ *
+ * \streamin{in_imgN,cv::Mat}
+ * Images to be checked, N = 0..count-1 (in_img is an alias of in_img0)
+ * \streamin{in_featuresN,Types::Features}
+ * Features to be checked, N = 0..count-1 (in_features is an alias of in_features0)
+ *
+ *
+ * \par Event handlers:
+ *
+ * \handler{onNewImageN}
+ * New image arrived
+ * \handler{onNewFeaturesN}
+ * New features arrived
+ *
+ *
+ * \par Properties:
+ *
+ * \prop{count,int,1}
+ * Number of checked streams
+ * \prop{directory,string,"golden"}
+ * Directory with golden results
+ * \prop{names,string,""}
+ * Comma separated names of streams (names of golden files), by default: stream0, stream1, ...
+ * \prop{mode,string,"compare"}
+ * "compare" or "record"
+ * \prop{tolerance.max_diff,string,"0"}
+ * Allowed difference of element values, comma separated list (one value for all streams or one for each)
+ * \prop{tolerance.fraction,string,"0"}
+ * Allowed fraction of elements differing more than max_diff, comma separated list
+ * \prop{report.file,string,""}
+ * Name of the report file, empty - results are only logged
+ *
+ * @{
+ *
+ * @}
+ */
+
+namespace Sinks {
+namespace GoldenCompare {
+
+/*!
+ * \class GoldenCompare_Sink
+ * \brief Compares received results with golden ones.
+ */
+class GoldenCompare_Sink: public Base::Component {
+public:
+	/*!
+	 * Constructor.
+	 */
+	GoldenCompare_Sink(const std::string & name = "GoldenCompare");
+
+	/*!
+	 * Destructor
+	 */
+	virtual ~GoldenCompare_Sink();
+
+	/*!
+	 * Prepare components interface (register streams and handlers).
+	 */
+	void prepareInterface();
+
+protected:
+
+	/*!
+	 * Opens golden files.
+	 */
+	bool onInit();
+
+	/*!
+	 * Closes golden files and logs the summary.
+	 */
+	bool onFinish();
+
+	/*!
+	 * Start component
+	 */
+	bool onStart();
+
+	/*!
+	 * Stop component
+	 */
+	bool onStop();
+
+	/*!
+	 * Event handler function - new image arrived on n-th stream.
+	 */
+	void onNewImageN(int n);
+
+	/*!
+	 * Event handler function - new features arrived on n-th stream.
+	 */
+	void onNewFeaturesN(int n);
+
+	/// Records or checks next result of n-th stream.
+	void check(int n, const cv::Mat & result);
+
+	/// State of single stream.
+	struct Stream {
+		std::string name;
+		double max_diff;
+		double fraction;
+
+		boost::shared_ptr<Types::FrameContainerReader> golden;
+		boost::shared_ptr<Types::FrameContainerWriter> recorder;
+
+		/// Index of the next result.
+		size_t frame;
+
+		unsigned long passed;
+		unsigned long failed;
+		unsigned long missing;
+	};
+
+	/// Input images.
+	std::vector<Base::DataStreamIn<cv::Mat, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex> *> in_img;
+
+	/// Input features.
+	std::vector<Base::DataStreamIn<Types::Features, Base::DataStreamBuffer::Newest, Base::Synchronization::Mutex> *> in_features;
+
+	std::vector<Base::EventHandler2 *> handlers;
+
+	std::vector<Stream> streams;
+
+	/// Set in record mode.
+	bool recording;
+
+	std::ofstream report;
+
+	/// Protects streams and report - they may be handled by different executors.
+	boost::mutex streams_mutex;
+
+	Base::Property<int> count;
+	Base::Property<std::string> directory;
+	Base::Property<std::string> names;
+	Base::Property<std::string> mode;
+	Base::Property<std::string> tolerance_max_diff;
+	Base::Property<std::string> tolerance_fraction;
+	Base::Property<std::string> report_file;
+};
+
+}//: namespace GoldenCompare
+}//: namespace Sinks
+
+/*
+ * Register sink component.
+ */
+REGISTER_COMPONENT("GoldenCompare", Sinks::GoldenCompare::GoldenCompare_Sink)
+
+#endif /* GOLDENCOMPARE_SINK_HPP_ */
@@ -6,9 +6,12 @@
 
 #include <memory>
 #include <string>
+#include <algorithm>
 
 #include "HSVLUT.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 #include <boost/bind.hpp>
 
@@ -22,13 +25,17 @@ HSVLUT::HSVLUT(const std::string & name) :
 		m_sat_threshold_low("saturation.threshold.low", 0, "range"),
 		m_sat_threshold_high("saturation.threshold.high", 255, "range"),
 		m_val_threshold_low("value.threshold.low", 0, "range"),
-		m_val_threshold_high("value.threshold.high", 255, "range")
+		m_val_threshold_high("value.threshold.high", 255, "range"),
+		m_lut("lut", false),
+		m_classes("classes", std::string("")),
+		m_conversion("conversion", std::string("")),
+		m_threads("threads", 1)
 {
-	// Constraints.
+	// Constraints - hue is 0..180, or 0..255 after _FULL conversions.
 	m_hue_threshold_low.addConstraint("0");
-	m_hue_threshold_low.addConstraint("180");
+	m_hue_threshold_low.addConstraint("255");
 	m_hue_threshold_high.addConstraint("0");
-	m_hue_threshold_high.addConstraint("180");
+	m_hue_threshold_high.addConstraint("255");
 
 	m_sat_threshold_low.addConstraint("0");
 	m_sat_threshold_low.addConstraint("255");
@@ -47,6 +54,18 @@ HSVLUT::HSVLUT(const std::string & name) :
 	registerProperty(m_val_threshold_low);
 	registerProperty(m_val_threshold_high);
 
+	m_lut.setToolTip("Classify pixels with precomputed lookup table");
+	registerProperty(m_lut);
+	m_classes.setToolTip("Additional classes: low-high,low-high,low-high;...");
+	registerProperty(m_classes);
+	m_conversion.setToolTip("Conversion of the input image to HSV (BGR2HSV, RGB2HSV, BGR2HSV_FULL, RGB2HSV_FULL), empty - input is HSV");
+	registerProperty(m_conversion);
+	m_threads.setToolTip("Number of threads processing the image (0 - all cores)");
+	registerProperty(m_threads);
+
+	// Hue is circular.
+	mask.setWrapping(0, true);
+
 	LOG(LTRACE) << "Hello HSVLUT\n";
 }
 
@@ -59,13 +78,18 @@ void HSVLUT::prepareInterface() {
 
 	registerStream("in_img", &in_img);
 	registerStream("out_img", &out_img);
+	registerStream("out_labels", &out_labels);
 
 	// Add default dependency of the onNewImage.
 	addDependency("onNewImage", &in_img);
 }
 
 bool HSVLUT::onInit() {
-
+	int code;
+	if (!conversionCode(m_conversion, code)) {
+		LOG(LERROR) << name() << ": unknown conversion " << std::string(m_conversion);
+		return false;
+	}
 	return true;
 }
 
@@ -81,55 +105,97 @@ bool HSVLUT::onStart() {
 	return true;
 }
 
+void HSVLUT::classify(const cv::Mat & hsv, cv::Mat & mask_out, cv::Mat & labels_out)
+{
+	if (m_lut)
+		lut.apply(hsv, labels_out, &mask_out);
+	else
+		mask.apply(hsv, mask_out);
+}
+
+void HSVLUT::processRows(const cv::Range & rows, const cv::Mat & src, int code)
+{
+	// Converted image is never stored as a whole - bands of rows are converted
+	// and classified while they are still in the cache.
+	int band = (code < 0) ? rows.size() : std::max(1, BandPixels / std::max(src.cols, 1));
+	cv::Mat hsv;
+	for (int y = rows.start; y < rows.end; y += band) {
+		cv::Range r(y, std::min(y + band, rows.end));
+		if (code < 0)
+			hsv = src.rowRange(r);
+		else
+			cv::cvtColor(src.rowRange(r), hsv, code);
+
+		cv::Mat mask_band = tmp_img.rowRange(r);
+		cv::Mat labels_band;
+		if (m_lut)
+			labels_band = labels.rowRange(r);
+		classify(hsv, mask_band, labels_band);
+	}
+}
+
+bool HSVLUT::conversionCode(const std::string & conversion, int & code)
+{
+	if (conversion.empty()) code = -1;
+	else if (conversion == "BGR2HSV") code = CV_BGR2HSV;
+	else if (conversion == "RGB2HSV") code = CV_RGB2HSV;
+	else if (conversion == "BGR2HSV_FULL") code = CV_BGR2HSV_FULL;
+	else if (conversion == "RGB2HSV_FULL") code = CV_RGB2HSV_FULL;
+	else return false;
+	return true;
+}
+
 void HSVLUT::onNewImage()
 {
 	LOG(LTRACE) << "HSVLUT::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat rgb_img = in_img.read();
-
-		cv::Size size = rgb_img.size();
-
-		tmp_img.create(size, CV_8UC1);
-
-		// Check the arrays for continuity and, if this is the case,
-		// treat the arrays as 1D vectors
-		if (rgb_img.isContinuous() && tmp_img.isContinuous()) {
-			size.width *= size.height;
-			size.height = 1;
+		probe.bytesIn(rgb_img);
+
+		// Image in unknown colour space isn't classified.
+		int code;
+		std::string conversion = m_conversion;
+		if (!conversionCode(conversion, code)) {
+			if (conversion != m_bad_conversion)
+				LOG(LERROR) << name() << ": unknown conversion " << conversion << ", images are not processed";
+			m_bad_conversion = conversion;
+			return;
 		}
-		size.width *= 3;
-
-		for (int i = 0; i < size.height; i++) {
-			// when the arrays are continuous,
-			// the outer loop is executed only once
-			// if not - it's executed for each row
-			const uchar* rgb_p = rgb_img.ptr <uchar> (i);
-			uchar* tmp_p = tmp_img.ptr <uchar> (i);
-
-			int j, k = 0;
-			for (j = 0; j < size.width; j += 3) {
-				uchar h = rgb_p[j];
-				uchar s = rgb_p[j + 1];
-				uchar v = rgb_p[j + 2];
-
-				uchar val = 255;
-				//  Red.
-				if ((h < m_hue_threshold_low) || (h > m_hue_threshold_high))
-					val = 0;
-				//  Green.
-				else if ((s < m_sat_threshold_low) || (s > m_sat_threshold_high))
-					val = 0;
-				//  val.
-				else if ((v < m_val_threshold_low) || (v > m_val_threshold_high))
-					val = 0;
-
-				tmp_p[k] = val;
-
-				++k;
+		m_bad_conversion.clear();
+
+		// All channels are compared at once, with vector instructions if available.
+		mask.setRange(0, m_hue_threshold_low, m_hue_threshold_high);
+		mask.setRange(1, m_sat_threshold_low, m_sat_threshold_high);
+		mask.setRange(2, m_val_threshold_low, m_val_threshold_high);
+
+		if (m_lut) {
+			// First class is given by the thresholds, table is rebuilt only if any class has changed.
+			// Malformed list is reported once, when it is set.
+			std::string error;
+			if (class_list.update(m_classes, error) && !error.empty())
+				LOG(LERROR) << name() << ": invalid classes - " << error;
+			std::vector<Types::RangeMask> classes = class_list.classes();
+			for (size_t k = 0; k < classes.size(); ++k)
+				classes[k].setWrapping(0, true);
+			classes.insert(classes.begin(), mask);
+			if (lut.setClasses(classes)) {
+				LOG(LINFO) << name() << ": lookup table rebuilt for " << lut.classes() << " classes";
+				if (classes.size() > lut.classes())
+					LOG(LWARNING) << name() << ": " << classes.size() << " classes given, only the first "
+							<< lut.classes() << " are used";
 			}
+			labels.create(rgb_img.size(), CV_8UC1);
 		}
+		tmp_img.create(rgb_img.size(), CV_8UC1);
+
+		Types::parallelRows(rgb_img.rows, m_threads, boost::bind(&HSVLUT::processRows, this, _1, boost::cref(rgb_img), code));
+
+		if (m_lut)
+			out_labels.write(labels);
 
 		// Write output to stream.
+		probe.bytesOut(tmp_img);
 		out_img.write(tmp_img);
 	}
 	catch (Common::DisCODeException& ex) {
@@ -140,6 +206,9 @@ void HSVLUT::onNewImage()
 	catch (const char * ex) {
 		LOG(LERROR) << ex;
 	}
+	catch (std::exception & ex) {
+		LOG(LERROR) << "HSVLUT::onNewImage failed: " << ex.what();
+	}
 	catch (...) {
 		LOG(LERROR) << "HSVLUT::onNewImage failed\n";
 	}
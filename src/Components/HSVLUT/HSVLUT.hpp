@@ -16,6 +16,9 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "Types/RangeMask.hpp"
+#include "Types/ColorLUT.hpp"
+
 
 namespace Processors {
 namespace HSVLUT {
@@ -24,7 +27,22 @@ namespace HSVLUT {
  * \class HSVLUT
  * \brief HSVLUT processor class.
  *
- * HSVLUT processor.
+ * HSVLUT processor - marks pixels with hue, saturation and value within given ranges.
+ * Hue range with low > high wraps around (e.g. hue 170..10 selects reds), such ranges
+ * of saturation and value match nothing.
+ *
+ * In lookup table mode (lut property) pixels are classified with precomputed table of all
+ * colours, which is rebuilt only when thresholds change. Thresholds define the first class,
+ * next ones can be given in classes property ("low-high,low-high,low-high;..."), and
+ * out_labels receives the number of the first matching class of every pixel (0 - none).
+ *
+ * If conversion property is set, input is BGR (or RGB) image, which is converted to HSV
+ * and classified band by band, so the whole HSV image is never written to memory - it
+ * replaces CvColorConv followed by HSVLUT. Hue is in range 0..180, except the _FULL
+ * conversions, which give hue in range 0..255 (hue thresholds accept both). Unknown
+ * conversion fails the initialization (or, when set later, stops processing until corrected).
+ *
+ * Bands of rows can be processed in parallel, by threads number of threads.
  */
 class HSVLUT: public Base::Component {
 public:
@@ -72,15 +90,46 @@ protected:
 	 */
 	void onNewImage();
 
+	/// Computes mask (and labels, in lookup table mode) of HSV image.
+	void classify(const cv::Mat & hsv, cv::Mat & mask_out, cv::Mat & labels_out);
+
+	/// Converts (if code >= 0) and classifies given rows of the input.
+	void processRows(const cv::Range & rows, const cv::Mat & src, int code);
+
+	/*!
+	 * Finds OpenCV code of the conversion to HSV.
+	 *
+	 * \param code set to the code, -1 if the conversion is empty (input is HSV)
+	 * \return false if the conversion is unknown
+	 */
+	static bool conversionCode(const std::string & conversion, int & code);
+
 	/// Input image
 	Base::DataStreamIn <cv::Mat> in_img;
 
 	/// Output data stream - image.
 	Base::DataStreamOut <cv::Mat> out_img;
 
+	/// Output data stream - labels of classes (in lookup table mode).
+	Base::DataStreamOut <cv::Mat> out_labels;
+
 private:
 	cv::Mat tmp_img;
 
+	/// Thresholding of all channels.
+	Types::RangeMask mask;
+
+	/// Lookup table of colour classes.
+	Types::ColorLUT lut;
+
+	/// Additional classes, parsed from the classes property.
+	Types::ColorClassList class_list;
+
+	cv::Mat labels;
+
+	/// Number of pixels converted at once, when the input is converted to HSV.
+	static const int BandPixels = 8192;
+
 	Base::Property<int> m_hue_threshold_low;
 	Base::Property<int> m_hue_threshold_high;
 	Base::Property<int> m_sat_threshold_low;
@@ -88,6 +137,21 @@ private:
 	Base::Property<int> m_val_threshold_low;
 	Base::Property<int> m_val_threshold_high;
 
+	/// Classify with lookup table.
+	Base::Property<bool> m_lut;
+
+	/// Additional classes (lookup table mode).
+	Base::Property<std::string> m_classes;
+
+	/// Conversion of the input to HSV.
+	Base::Property<std::string> m_conversion;
+
+	/// Unknown conversion, already reported.
+	std::string m_bad_conversion;
+
+	/// Number of threads.
+	Base::Property<int> m_threads;
+
 };
 
 } //: namespace HSVLUT
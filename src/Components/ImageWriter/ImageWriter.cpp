@@ -8,6 +8,9 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
 
 #include "ImageWriter.hpp"
 #include "Common/Logger.hpp"
@@ -16,18 +19,98 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace Processors {
 namespace ImageWriter {
 
+namespace {
+
+/// Splits comma separated list of numbers - one for each stream, single value is used for all, -1 for missing ones.
+std::vector<int> splitParams(const std::string & list, int count) {
+	std::vector<std::string> items;
+	std::string l = list;
+	boost::split(items, l, boost::is_any_of(","));
+
+	std::vector<int> values(count, -1);
+	for (int i = 0; i < count; ++i) {
+		std::string item = boost::trim_copy(items.size() == 1 ? items[0] : (i < (int)items.size() ? items[i] : std::string()));
+		if (!item.empty())
+			values[i] = boost::lexical_cast<int>(item);
+	}
+	return values;
+}
+
+/// Next free numbers of counter named files (by directory and base name), shared by all writers in the process.
+std::map<std::string, long> next_numbers;
+boost::mutex next_numbers_mutex;
+
+/// Separator of the base name and the number of the file.
+const char NumberSeparator = '_';
+
+/// Returns the highest number of file named base_<number>.* in the directory (or its shards), -1 if there is none.
+long lastNumber(const std::string & directory, const std::string & base) {
+	namespace fs = boost::filesystem;
+
+	long last = -1;
+	std::vector<fs::path> dirs(1, fs::path(directory));
+	for (size_t d = 0; d < dirs.size(); ++d) {
+		if (!fs::is_directory(dirs[d]))
+			continue;
+
+		for (fs::directory_iterator it(dirs[d]), end; it != end; ++it) {
+			if (fs::is_directory(it->status())) {
+				if (d == 0)
+					dirs.push_back(it->path());
+				continue;
+			}
+
+			// Separator anchors the number, so files of base "img" don't match "img0_*".
+			std::string name = it->path().filename().string();
+			size_t start = base.size() + 1;
+			if (name.size() <= start || name.compare(0, base.size(), base) != 0 || name[base.size()] != NumberSeparator)
+				continue;
+			size_t dot = name.find_first_not_of("0123456789", start);
+			if (dot == start || dot == std::string::npos || name[dot] != '.')
+				continue;
+			last = std::max(last, std::atol(name.substr(start, dot - start).c_str()));
+		}
+	}
+	return last;
+}
+
+/// Claims next number for the file. Files already present in the directory are never overwritten.
+long claimNumber(const std::string & directory, const std::string & base) {
+	boost::mutex::scoped_lock lock(next_numbers_mutex);
+
+	std::string key = directory + "/" + base;
+	std::map<std::string, long>::iterator it = next_numbers.find(key);
+	if (it == next_numbers.end())
+		it = next_numbers.insert(std::make_pair(key, lastNumber(directory, base) + 1)).first;
+	return it->second++;
+}
+
+}
+
 ImageWriter::ImageWriter(const std::string & name) :
 		Base::Component(name),
 		directory("directory", std::string(".")),
 		base_name("base_name", std::string("img")),
 		format("format", std::string("png")),
-		digits("digits", 2),
+		digits("digits", 6),
 		count("count", 1),
-		prop_auto_trigger("auto_trigger", false)
+		prop_auto_trigger("auto_trigger", false),
+		prop_queue_threads("queue.threads", 0),
+		prop_queue_size("queue.size", 16),
+		prop_queue_overflow("queue.overflow", std::string("block")),
+		prop_png_compression("encoder.png_compression", std::string("")),
+		prop_jpeg_quality("encoder.jpeg_quality", std::string("")),
+		prop_webp_quality("encoder.webp_quality", std::string("")),
+		prop_tiff_compression("encoder.tiff_compression", std::string("")),
+		prop_fast_lossless("encoder.fast_lossless", false),
+		prop_naming("naming", std::string("time")),
+		prop_naming_shard("naming.shard", 0)
 {
 	registerProperty(directory);
 	registerProperty(base_name);
@@ -35,6 +118,16 @@ ImageWriter::ImageWriter(const std::string & name) :
 	registerProperty(digits);
 	registerProperty(count);
 	registerProperty(prop_auto_trigger);
+	registerProperty(prop_queue_threads);
+	registerProperty(prop_queue_size);
+	registerProperty(prop_queue_overflow);
+	registerProperty(prop_png_compression);
+	registerProperty(prop_jpeg_quality);
+	registerProperty(prop_webp_quality);
+	registerProperty(prop_tiff_compression);
+	registerProperty(prop_fast_lossless);
+	registerProperty(prop_naming);
+	registerProperty(prop_naming_shard);
 }
 
 ImageWriter::~ImageWriter() {
@@ -66,6 +159,9 @@ void ImageWriter::prepareInterface() {
 	registerStream("in_img", in_img[0]);
 
 	counts.resize(count, 0);
+	shards.resize(count, -1);
+	containers.resize(count);
+	container_names.resize(count);
 
 	std::string t = base_name;
 	boost::split(base_names, t, boost::is_any_of(","));
@@ -95,10 +191,60 @@ void ImageWriter::prepareInterface() {
 }
 
 bool ImageWriter::onInit() {
+	encoders.clear();
+	encode_stats.clear();
+	try {
+		std::vector<int> png = splitParams(prop_png_compression, count);
+		std::vector<int> jpeg = splitParams(prop_jpeg_quality, count);
+		std::vector<int> webp = splitParams(prop_webp_quality, count);
+		std::vector<int> tiff = splitParams(prop_tiff_compression, count);
+		for (int i = 0; i < count; ++i) {
+			Types::EncoderSettings enc;
+			enc.png_compression = png[i];
+			enc.jpeg_quality = jpeg[i];
+			enc.webp_quality = webp[i];
+			enc.tiff_compression = tiff[i];
+			enc.fast_lossless = prop_fast_lossless;
+			encoders.push_back(enc);
+			encode_stats.push_back(boost::shared_ptr<Types::EncodeStats>(new Types::EncodeStats));
+		}
+	} catch (boost::bad_lexical_cast &) {
+		CLOG(LERROR) << "Invalid encoder parameters";
+		return false;
+	}
+
+	if (prop_queue_threads > 0) {
+		queue.start(boost::bind(&ImageWriter::writeImage, this, _1), prop_queue_threads, prop_queue_size,
+				WriteQueue::overflowFromString(prop_queue_overflow));
+	}
 	return true;
 }
 
 bool ImageWriter::onFinish() {
+	// Flush pending images before closing containers.
+	if (queue.running()) {
+		queue.stop();
+		CLOG(LINFO) << "Images queued: " << queue.queued() << " written: " << queue.written()
+				<< " dropped: " << queue.dropped() << " failed: " << queue.failed()
+				<< " (max. " << queue.highWater() << " waiting)";
+	}
+
+	for (size_t i = 0; i < encode_stats.size(); ++i) {
+		if (encode_stats[i]->count() > 0) {
+			CLOG(LINFO) << "Stream " << i << ": " << encode_stats[i]->count() << " images written, "
+					<< encode_stats[i]->averageMs() << " ms avg, " << encode_stats[i]->maxMs() << " ms max, "
+					<< encode_stats[i]->throughput() << " MB/s";
+		}
+	}
+
+	for (size_t i = 0; i < containers.size(); ++i) {
+		if (containers[i]) {
+			CLOG(LINFO) << "Closing frame container " << i << " (" << containers[i]->size() << " frames)";
+			containers[i]->close();
+			containers[i].reset();
+		}
+		container_names[i].clear();
+	}
 	return true;
 }
 
@@ -129,8 +275,6 @@ void ImageWriter::onSaveTriggered(){
 void ImageWriter::write_image_N(int n) {
 	CLOG(LTRACE) << name() << "::write_image_N(" << n << ")";
 
-	boost::posix_time::ptime tm = boost::posix_time::microsec_clock::local_time();
-
 	// Check working mode.
 	if ((!prop_auto_trigger && !save_flags[n])){
 		return;
@@ -140,24 +284,30 @@ void ImageWriter::write_image_N(int n) {
 	try {
 		if(!in_img[n]->empty()){
 			counts[n] = counts[n] + 1;
-			std::stringstream ss;
-			ss << std::setw(digits) << std::setfill('0') << counts[n];
-			//std::string fname = std::string(directory) + "/" + base_names[n] + boost::lexical_cast<std::string>(counts[n]) + "." + formats[n];
-			std::string fname = std::string(directory) + "/" + boost::posix_time::to_iso_extended_string(tm) + "_" + base_names[n] + "." + formats[n];
-
-			// Write to file depending on the extension.
-			// Write to yaml.
-			if ((formats[n] == "yaml") || (formats[n] == "yml") || (formats[n] == "xml") || (formats[n] == "yml.gz") || (formats[n] == "yaml.gz") || (formats[n] == "xml.gz")){
-				CLOG(LNOTICE) << "Writing "<< n <<"-th image to YAML file" << fname;
-			    cv::FileStorage fs(fname, cv::FileStorage::WRITE);
-				fs << "img" << in_img[n]->read();
-			    fs.release();
+
+			WriteJob job;
+			job.stream = n;
+			job.format = formats[n];
+			job.img = in_img[n]->read();
+
+			// Images appended to the container share the name of the first one, so they
+			// don't claim counter numbers nor create shard directories.
+			job.ordered = (formats[n] == Types::FrameContainer::Extension) || encoders[n].useFastLossless(job.img);
+			if (job.ordered) {
+				if (container_names[n].empty())
+					container_names[n] = fileName(n);
+				job.fname = container_names[n];
+			} else {
+				job.fname = fileName(n);
 			}
-			else
-			{
-				CLOG(LNOTICE) << "Writing "<< n <<"-th image to file" << fname;
-				cv::imwrite(fname, in_img[n]->read());
 
+			if (queue.running()) {
+				// Producer may overwrite its buffer in the next step.
+				job.img = job.img.clone();
+				if (!queue.push(job))
+					CLOG(LDEBUG) << "Write queue full - image dropped";
+			} else {
+				writeImage(job);
 			}
 		}
 		else
@@ -168,6 +318,76 @@ void ImageWriter::write_image_N(int n) {
 	}
 }
 
+std::string ImageWriter::fileName(int n) {
+	std::string dir = directory;
+
+	if (std::string(prop_naming) != "counter") {
+		boost::posix_time::ptime tm = boost::posix_time::microsec_clock::local_time();
+		return dir + "/" + boost::posix_time::to_iso_extended_string(tm) + "_" + base_names[n] + "." + formats[n];
+	}
+
+	long number = claimNumber(dir, base_names[n]);
+
+	// Every naming.shard consecutive files go to separate subdirectory.
+	if (prop_naming_shard > 0) {
+		long shard = number / prop_naming_shard;
+		char sub[32];
+		std::sprintf(sub, "/%06ld", shard);
+		dir += sub;
+		if (shard != shards[n]) {
+			boost::filesystem::create_directories(dir);
+			shards[n] = shard;
+		}
+	}
+
+	char num[32];
+	std::sprintf(num, "%c%0*ld", NumberSeparator, (int)digits, number);
+	return dir + "/" + base_names[n] + num + "." + formats[n];
+}
+
+bool ImageWriter::writeImage(const WriteJob & job) {
+	int n = job.stream;
+
+	try {
+		Types::EncodeTimer timer(*encode_stats[n], job.img);
+
+		// Write to file depending on the extension.
+		// Append to frame container - deep images in fast lossless mode go there too, so the
+		// whole recording is single file, named after the first image.
+		if (job.format == Types::FrameContainer::Extension || encoders[n].useFastLossless(job.img)) {
+			if (!containers[n]) {
+				std::string fname = job.fname.substr(0, job.fname.size() - job.format.size()) + Types::FrameContainer::Extension;
+				containers[n].reset(new Types::FrameContainerWriter);
+				if (!containers[n]->open(fname)) {
+					CLOG(LERROR) << "Couldn't create frame container " << fname;
+					containers[n].reset();
+					return false;
+				}
+				CLOG(LNOTICE) << "Writing "<< n <<"-th stream to frame container " << fname;
+			}
+			return containers[n]->write(job.img);
+		}
+		// Write to yaml.
+		else if ((job.format == "yaml") || (job.format == "yml") || (job.format == "xml") || (job.format == "yml.gz") || (job.format == "yaml.gz") || (job.format == "xml.gz")){
+			CLOG(LNOTICE) << "Writing "<< n <<"-th image to YAML file" << job.fname;
+			cv::FileStorage fs(job.fname, cv::FileStorage::WRITE);
+			fs << "img" << job.img;
+			fs.release();
+			return true;
+		}
+		else
+		{
+			CLOG(LNOTICE) << "Writing "<< n <<"-th image to file" << job.fname;
+			return Types::writeImage(job.fname, job.format, job.img, encoders[n]);
+		}
+	}
+	catch(std::exception &ex) {
+		CLOG(LERROR) << "ImageWriter::writeImage failed: " << ex.what() << "\n";
+	}
+
+	return false;
+}
+
 
 
 } //: namespace ImageWriter
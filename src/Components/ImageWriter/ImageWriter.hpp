@@ -13,6 +13,11 @@
 #include "Property.hpp"
 #include "EventHandler2.hpp"
 
+#include "Types/FrameContainer.hpp"
+#include "Types/ImageEncoding.hpp"
+
+#include "WriteQueue.hpp"
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
@@ -23,7 +28,52 @@ namespace ImageWriter {
  * \class ImageWriter
  * \brief ImageWriter processor class.
  *
- * Image writer
+ * Image writer. Besides image formats supported by OpenCV and yml/xml(.gz) files,
+ * \c cvraw format can be used - all images from the stream are appended to the
+ * single \ref Types::FrameContainerWriter "frame container", which can be read back
+ * by the Sequence component.
+ *
+ * With queue.threads greater than 0 images are only queued in the handler and
+ * encoded/written by background threads (write-behind), so that saving doesn't
+ * slow down the processing. Images are copied when queued, as producers may
+ * reuse their buffers. Pending images are written before the component finishes.
+ *
+ * With naming set to "counter" files are named base_name followed by underscore and
+ * the number (zero padded to digits), which continues from the highest number already present
+ * in the directory and is shared by all writers using the same directory and base name,
+ * so files are never overwritten. Such files can be read directly by Sequence (with
+ * sequence.sharded set, if naming.shard is used).
+ *
+ * \prop{digits,int,6}
+ * In counter mode - minimal number of digits of the number. Longer numbers break the
+ * lexicographic order of names, such sequences have to be read with mode.natural_sort
+ * \prop{naming,string,"time"}
+ * File naming: "time" (ISO time of writing followed by base_name) or "counter"
+ * \prop{naming.shard,int,0}
+ * In counter mode - number of files in single subdirectory (named with the number
+ * of the shard), 0 - all files are written directly to the directory
+ * \prop{queue.threads,int,0}
+ * Number of encoder threads, 0 - images are written in the handler
+ * \prop{queue.size,int,16}
+ * Maximum number of images waiting for being written
+ * \prop{queue.overflow,string,"block"}
+ * What to do when the queue is full: "block" (wait), "drop_oldest" or "drop_newest"
+ *
+ * Encoder parameters can be given for each stream separately (as comma separated
+ * lists, like base_name and format), empty value leaves OpenCV default.
+ * Time of writing images is measured and reported when the component finishes.
+ *
+ * \prop{encoder.png_compression,string,""}
+ * PNG compression level (0-9), lower is faster
+ * \prop{encoder.jpeg_quality,string,""}
+ * JPEG quality (0-100)
+ * \prop{encoder.webp_quality,string,""}
+ * WebP quality (1-100, above 100 - lossless)
+ * \prop{encoder.tiff_compression,string,""}
+ * TIFF compression scheme (libtiff code, 1 - none), requires OpenCV 3.4
+ * \prop{encoder.fast_lossless,bool,false}
+ * If set, images deeper than 8 bits (e.g. depth maps) are written uncompressed, appended to one cvraw file per stream
+ * (named after the first of them)
  */
 class ImageWriter: public Base::Component {
 public:
@@ -100,6 +150,16 @@ protected:
 	/// Handlers
 	void write_image_N(int n);
 
+	/// Returns name of the next file of n-th stream.
+	std::string fileName(int n);
+
+	/*!
+	 * Writes single image to file (or container), called directly or by the encoder threads.
+	 *
+	 * \return false if image couldn't be written
+	 */
+	bool writeImage(const WriteJob & job);
+
 	/// Number of image streams.
 	std::vector<int> counts;
 
@@ -109,6 +169,45 @@ protected:
     /// Flag indicating whether the set of images images should saved or not (trigger).
 	std::vector<bool> save_flags;
 
+	/// Frame containers, opened on first write to stream with cvraw format (or of deep image in fast lossless mode).
+	std::vector<boost::shared_ptr<Types::FrameContainerWriter> > containers;
+
+	/// Names of the containers, given on first write.
+	std::vector<std::string> container_names;
+
+	/// Number of encoder threads.
+	Base::Property<int> prop_queue_threads;
+
+	/// Maximum number of queued images.
+	Base::Property<int> prop_queue_size;
+
+	/// Queue overflow policy.
+	Base::Property<std::string> prop_queue_overflow;
+
+	/// Images waiting for encoder threads.
+	WriteQueue queue;
+
+	Base::Property<std::string> prop_png_compression;
+	Base::Property<std::string> prop_jpeg_quality;
+	Base::Property<std::string> prop_webp_quality;
+	Base::Property<std::string> prop_tiff_compression;
+	Base::Property<bool> prop_fast_lossless;
+
+	/// File naming mode.
+	Base::Property<std::string> prop_naming;
+
+	/// Number of files in single subdirectory.
+	Base::Property<int> prop_naming_shard;
+
+	/// Current shard of each stream (its subdirectory is already created).
+	std::vector<long> shards;
+
+	/// Encoder parameters of each stream.
+	std::vector<Types::EncoderSettings> encoders;
+
+	/// Time of writing images of each stream.
+	std::vector<boost::shared_ptr<Types::EncodeStats> > encode_stats;
+
 
 };
 
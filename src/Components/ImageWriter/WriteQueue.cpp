@@ -0,0 +1,161 @@
+/*!
+ * \file WriteQueue.cpp
+ * \brief Write-behind queue of images - methods definition.
+ */
+
+#include "WriteQueue.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+namespace Processors {
+namespace ImageWriter {
+
+WriteQueue::WriteQueue() :
+	m_capacity(1), m_overflow(Block), m_stopping(false),
+	m_queued(0), m_written(0), m_dropped(0), m_failed(0), m_high_water(0) {
+}
+
+WriteQueue::~WriteQueue() {
+	stop();
+}
+
+void WriteQueue::start(Writer writer, int threads, int capacity, Overflow overflow) {
+	stop();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_writer = writer;
+	m_capacity = std::max(capacity, 1);
+	m_overflow = overflow;
+	m_queued = m_written = m_dropped = m_failed = 0;
+	m_high_water = 0;
+
+	for (int i = 0; i < std::max(threads, 1); ++i)
+		m_workers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&WriteQueue::work, this))));
+}
+
+void WriteQueue::stop() {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+	m_cond.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i]->join();
+	m_workers.clear();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_stopping = false;
+}
+
+bool WriteQueue::running() const {
+	return !m_workers.empty();
+}
+
+bool WriteQueue::push(const WriteJob & job) {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	bool accepted = true;
+	if (m_jobs.size() >= m_capacity) {
+		switch (m_overflow) {
+		case DropNewest:
+			++m_dropped;
+			return false;
+		case DropOldest:
+			m_jobs.pop_front();
+			++m_dropped;
+			accepted = false;
+			break;
+		default:
+			while (m_jobs.size() >= m_capacity && !m_workers.empty())
+				m_cond.wait(lock);
+		}
+	}
+
+	m_jobs.push_back(job);
+	++m_queued;
+	m_high_water = std::max(m_high_water, m_jobs.size());
+	m_cond.notify_all();
+
+	return accepted;
+}
+
+void WriteQueue::work() {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	for (;;) {
+		// First job which can be written now - ordered jobs wait for the previous ones of their stream.
+		std::deque<WriteJob>::iterator it = m_jobs.begin();
+		while (it != m_jobs.end() && it->ordered && m_busy.count(it->stream))
+			++it;
+
+		if (it == m_jobs.end()) {
+			// Pending images are written before stopping.
+			if (m_stopping && m_jobs.empty())
+				return;
+			m_cond.wait(lock);
+			continue;
+		}
+
+		WriteJob job = *it;
+		m_jobs.erase(it);
+		if (job.ordered)
+			m_busy.insert(job.stream);
+		m_cond.notify_all();
+
+		lock.unlock();
+		bool ok = false;
+		try {
+			ok = m_writer(job);
+		} catch (...) {
+		}
+		job.img.release();
+		lock.lock();
+
+		if (job.ordered)
+			m_busy.erase(job.stream);
+		if (ok)
+			++m_written;
+		else
+			++m_failed;
+		m_cond.notify_all();
+	}
+}
+
+unsigned long WriteQueue::queued() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_queued;
+}
+
+unsigned long WriteQueue::written() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_written;
+}
+
+unsigned long WriteQueue::dropped() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_dropped;
+}
+
+unsigned long WriteQueue::failed() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_failed;
+}
+
+size_t WriteQueue::highWater() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_high_water;
+}
+
+WriteQueue::Overflow WriteQueue::overflowFromString(const std::string & name) {
+	if (name == "drop_oldest")
+		return DropOldest;
+	if (name == "drop_newest")
+		return DropNewest;
+	return Block;
+}
+
+}//: namespace ImageWriter
+}//: namespace Processors
@@ -0,0 +1,144 @@
+/*!
+ * \file WriteQueue.hpp
+ * \brief Write-behind queue of images - class declaration.
+ */
+
+#ifndef IMAGEWRITER_WRITEQUEUE_HPP_
+#define IMAGEWRITER_WRITEQUEUE_HPP_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Processors {
+namespace ImageWriter {
+
+/*!
+ * \brief Image waiting for being written.
+ */
+struct WriteJob {
+	/// Index of the input stream.
+	int stream;
+
+	/// Name of the file.
+	std::string fname;
+
+	/// File format.
+	std::string format;
+
+	/// Image to be written.
+	cv::Mat img;
+
+	/// If set, jobs of the same stream are written one by one, in order (e.g. appending to one file).
+	bool ordered;
+};
+
+/*!
+ * \class WriteQueue
+ * \brief Bounded queue of images drained by the pool of encoder threads.
+ *
+ * When the queue is full, new image is handled according to the overflow policy:
+ * producer waits for the free slot (Block), the oldest queued image is
+ * discarded (DropOldest) or the new one is discarded (DropNewest).
+ */
+class WriteQueue {
+public:
+	enum Overflow {
+		Block,
+		DropOldest,
+		DropNewest
+	};
+
+	typedef boost::function<bool(const WriteJob &)> Writer;
+
+	WriteQueue();
+
+	~WriteQueue();
+
+	/*!
+	 * Starts encoder threads. Previously started threads are stopped first.
+	 *
+	 * \param writer function writing single image, returns false on failure
+	 * \param threads number of encoder threads
+	 * \param capacity maximum number of queued images
+	 * \param overflow what to do when the queue is full
+	 */
+	void start(Writer writer, int threads, int capacity, Overflow overflow);
+
+	/*!
+	 * Waits until all queued images are written and stops encoder threads.
+	 */
+	void stop();
+
+	/// Returns true if encoder threads are running.
+	bool running() const;
+
+	/*!
+	 * Adds image to the queue.
+	 *
+	 * \return false if image (or the oldest one) was dropped
+	 */
+	bool push(const WriteJob & job);
+
+	/// Number of images accepted into the queue.
+	unsigned long queued() const;
+
+	/// Number of images written.
+	unsigned long written() const;
+
+	/// Number of images dropped because of overflow.
+	unsigned long dropped() const;
+
+	/// Number of images which couldn't be written.
+	unsigned long failed() const;
+
+	/// Maximum number of images waiting in the queue at once.
+	size_t highWater() const;
+
+	/// Converts policy name (block, drop_oldest, drop_newest) to enum, unknown names give Block.
+	static Overflow overflowFromString(const std::string & name);
+
+private:
+	/// Encoder thread body.
+	void work();
+
+	Writer m_writer;
+
+	std::deque<WriteJob> m_jobs;
+
+	/// Streams of ordered jobs being written at the moment.
+	std::set<int> m_busy;
+
+	size_t m_capacity;
+
+	Overflow m_overflow;
+
+	bool m_stopping;
+
+	unsigned long m_queued;
+	unsigned long m_written;
+	unsigned long m_dropped;
+	unsigned long m_failed;
+	size_t m_high_water;
+
+	mutable boost::mutex m_mutex;
+
+	/// Signalled when job is queued, taken or finished.
+	boost::condition_variable m_cond;
+
+	std::vector<boost::shared_ptr<boost::thread> > m_workers;
+};
+
+}//: namespace ImageWriter
+}//: namespace Processors
+
+#endif /* IMAGEWRITER_WRITEQUEUE_HPP_ */
@@ -6,9 +6,12 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "MaskAggregator.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 #include <boost/bind.hpp>
 
@@ -16,8 +19,10 @@ namespace Processors {
 namespace MaskAggregator {
 
 MaskAggregator::MaskAggregator(const std::string & name) :
-		Base::Component(name)  {
-
+		Base::Component(name),
+		threads("threads", 1) {
+	threads.setToolTip("Number of threads processing the masks (0 - all cores)");
+	registerProperty(threads);
 }
 
 MaskAggregator::~MaskAggregator() {
@@ -50,13 +55,29 @@ bool MaskAggregator::onStart() {
 	return true;
 }
 
+void MaskAggregator::aggregateRows(const cv::Range & rows, const std::vector<cv::Mat> & masks, cv::Mat & mask) {
+	cv::Mat band = mask.rowRange(rows);
+	masks[0].rowRange(rows).copyTo(band);
+	for (size_t i = 1; i < masks.size(); ++i)
+		masks[i].rowRange(rows).copyTo(band, band);
+}
+
 void MaskAggregator::onNewImage() {
-	cv::Mat mask = in_mask.read().clone();
+	INSTRUMENT_HANDLER(probe, "onNewImage");
+	std::vector<cv::Mat> masks;
+	masks.push_back(in_mask.read());
+	probe.bytesIn(masks[0]);
 	
 	while(!in_mask.empty()) {
-		in_mask.read().copyTo(mask, mask);
+		masks.push_back(in_mask.read());
+		probe.bytesIn(masks.back());
 	}
 	
+	// All masks are combined band by band, so each band stays in the cache.
+	cv::Mat mask(masks[0].size(), masks[0].type());
+	Types::parallelRows(mask.rows, threads, boost::bind(&MaskAggregator::aggregateRows, this, _1, boost::cref(masks), boost::ref(mask)));
+	
+	probe.bytesOut(mask);
 	out_mask.write(mask);
 }
 
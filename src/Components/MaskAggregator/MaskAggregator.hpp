@@ -23,7 +23,8 @@ namespace MaskAggregator {
  * \class MaskAggregator
  * \brief MaskAggregator processor class.
  *
- * 
+ * Combines all masks waiting in the input stream, bands of rows can be processed
+ * in parallel, by threads number of threads.
  */
 class MaskAggregator: public Base::Component {
 public:
@@ -77,10 +78,15 @@ protected:
 
 	// Properties
 
+	/// Number of threads.
+	Base::Property<int> threads;
 	
 	// Handlers
 	void onNewImage();
 
+	/// Combines given rows of the masks.
+	void aggregateRows(const cv::Range & rows, const std::vector<cv::Mat> & masks, cv::Mat & mask);
+
 };
 
 } //: namespace MaskAggregator
@@ -0,0 +1,250 @@
+/*!
+ * \file MovieDecoder.cpp
+ * \brief Background decoding of movie frames - methods definition.
+ */
+
+#include "MovieDecoder.hpp"
+#include "Logger.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+namespace Sources {
+namespace Movie {
+
+MovieDecoder::MovieDecoder() :
+	m_first(0), m_length(-1), m_chunk(1), m_buffer(1), m_loop(false), m_step(1), m_fps(25), m_pool(NULL),
+	m_next_chunk(0), m_consumed(0), m_end(0), m_active(0), m_stopping(false) {
+}
+
+MovieDecoder::~MovieDecoder() {
+	stop();
+}
+
+bool MovieDecoder::start(const std::string & filename, int first, int last, int threads, int chunk, int buffer, bool loop,
+		Types::FramePool * pool, int step) {
+	stop();
+
+	cv::VideoCapture probe(filename);
+	if (!probe.isOpened())
+		return false;
+
+	long count = (long)probe.get(CV_CAP_PROP_FRAME_COUNT);
+	m_fps = probe.get(CV_CAP_PROP_FPS);
+	if (m_fps <= 0)
+		m_fps = 25;
+	probe.release();
+
+	m_filename = filename;
+	m_first = std::max(first, 0);
+	if (last < 0 || (count > 0 && last > count))
+		last = count;
+	if (last >= 0 && last <= m_first)
+		m_length = 0;
+	else
+		m_length = (last > 0) ? last - m_first : -1;
+
+	// Without known length chunks can't be assigned to threads.
+	if (m_length < 0)
+		threads = 1;
+
+	m_chunk = std::max(chunk, 1);
+	m_buffer = std::max(buffer, 1);
+
+	// Thread decoding the next chunk can run only within the buffer, so all threads
+	// work at once only if the buffer holds a chunk for each of them. Buffer bounds
+	// the memory, so the chunks are shortened instead.
+	threads = std::max(threads, 1);
+	if (threads > 1 && m_buffer < m_chunk * threads) {
+		int chunk = std::max(m_buffer / threads, 1);
+		LOG(LINFO) << "MovieDecoder: chunk of " << m_chunk << " frames reduced to " << chunk << " - buffer of "
+				<< m_buffer << " frames is shared by " << threads << " threads";
+		m_chunk = chunk;
+	}
+	m_loop = loop;
+	m_step = std::max(step, 1);
+	m_pool = pool;
+
+	m_next_chunk = 0;
+	m_consumed = 0;
+	m_end = std::numeric_limits<long>::max();
+	if (m_length == 0 || (!m_loop && m_length > 0))
+		m_end = (m_length + m_step - 1) / m_step;
+
+	m_active = threads;
+	for (int i = 0; i < m_active; ++i)
+		m_workers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&MovieDecoder::work, this))));
+
+	return true;
+}
+
+void MovieDecoder::stop() {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+	m_cond.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i]->join();
+	m_workers.clear();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_ready.clear();
+	m_active = 0;
+	m_stopping = false;
+}
+
+bool MovieDecoder::running() const {
+	return !m_workers.empty();
+}
+
+bool MovieDecoder::next(cv::Mat & frame, double & timestamp) {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	long skipped = 0;
+	for (;;) {
+		while (!m_ready.count(m_consumed) && !finished(m_consumed))
+			m_cond.wait(lock);
+
+		std::map<long, Frame>::iterator it = m_ready.find(m_consumed);
+		if (it == m_ready.end())
+			return false;
+
+		Frame f = it->second;
+		m_ready.erase(it);
+		++m_consumed;
+		m_cond.notify_all();
+
+		// Frame which couldn't be decoded - skip it, unless nothing can be decoded at all.
+		if (f.img.empty()) {
+			if (++skipped > std::max(m_length, 1L))
+				return false;
+			continue;
+		}
+
+		frame = f.img;
+		timestamp = f.timestamp;
+		return true;
+	}
+}
+
+void MovieDecoder::acquire(cv::Mat & img, cv::Size size, int type) {
+	img = m_pool ? m_pool->acquire(size, type) : cv::Mat();
+}
+
+bool MovieDecoder::finished(long ticket) const {
+	return m_stopping || ticket >= m_end || (m_active == 0 && !m_ready.count(ticket));
+}
+
+void MovieDecoder::work() {
+	cv::VideoCapture cap(m_filename);
+	bool unknown = m_length < 0;
+
+	// Index of the frame, which will be returned by the capture.
+	long pos = 0;
+
+	// Geometry of the last decoded frame.
+	cv::Size size;
+	int type = 0;
+
+	for (bool done = !cap.isOpened(); !done; ) {
+		long begin, end;
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			if (m_stopping)
+				break;
+			if (unknown) {
+				// Single thread decodes the movie till the end.
+				if (m_next_chunk > 0)
+					break;
+				begin = 0;
+				end = std::numeric_limits<long>::max();
+			} else {
+				begin = m_next_chunk * m_chunk;
+				if (begin >= m_end)
+					break;
+				end = std::min(begin + m_chunk, m_end);
+			}
+			++m_next_chunk;
+		}
+
+		for (long t = begin; t < end; ++t) {
+			{
+				boost::mutex::scoped_lock lock(m_mutex);
+				while (!m_stopping && t >= m_consumed + m_buffer)
+					m_cond.wait(lock);
+				if (m_stopping) {
+					done = true;
+					break;
+				}
+			}
+
+			Frame f;
+			if (unknown) {
+				if (t == 0 && m_first > 0)
+					cap.set(CV_CAP_PROP_POS_FRAMES, m_first);
+				if (t == 0)
+					pos = m_first;
+
+				acquire(f.img, size, type);
+				cap >> f.img;
+				// End of the movie - rewind, if there was anything read since the last time.
+				if (f.img.empty() && m_loop && pos != m_first) {
+					cap.set(CV_CAP_PROP_POS_FRAMES, m_first);
+					pos = m_first;
+					acquire(f.img, size, type);
+					cap >> f.img;
+				}
+
+				if (f.img.empty()) {
+					boost::mutex::scoped_lock lock(m_mutex);
+					m_end = std::min(m_end, t);
+					done = true;
+					break;
+				}
+			} else {
+				long idx = m_first + (t * m_step) % m_length;
+				if (pos < idx && idx - pos < m_step) {
+					// Short distance forward - cheaper to grab frames than to seek.
+					while (pos < idx && cap.grab())
+						++pos;
+				}
+				if (pos != idx)
+					cap.set(CV_CAP_PROP_POS_FRAMES, idx);
+				pos = idx;
+				acquire(f.img, size, type);
+				cap >> f.img;
+			}
+
+			if (!f.img.empty()) {
+				size = f.img.size();
+				type = f.img.type();
+			}
+
+			f.timestamp = cap.get(CV_CAP_PROP_POS_MSEC) / 1000.0;
+			if (f.timestamp <= 0)
+				f.timestamp = pos / m_fps;
+			++pos;
+
+			// Frames between decoded ones (of the movie of unknown length) are only grabbed.
+			if (unknown) {
+				for (int i = 1; i < m_step && cap.grab(); ++i)
+					++pos;
+			}
+
+			boost::mutex::scoped_lock lock(m_mutex);
+			m_ready[t] = f;
+			m_cond.notify_all();
+		}
+	}
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	--m_active;
+	m_cond.notify_all();
+}
+
+}//: namespace Movie
+}//: namespace Sources
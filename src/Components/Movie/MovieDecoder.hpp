@@ -0,0 +1,144 @@
+/*!
+ * \file MovieDecoder.hpp
+ * \brief Background decoding of movie frames - class declaration.
+ */
+
+#ifndef MOVIE_DECODER_HPP_
+#define MOVIE_DECODER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "Types/FramePool.hpp"
+
+namespace Sources {
+namespace Movie {
+
+/*!
+ * \class MovieDecoder
+ * \brief Decodes frames of the movie segment in background threads.
+ *
+ * Each thread has its own capture and decodes chunks of consecutive frames
+ * (seeking to the beginning of the chunk). Decoded frames are kept in buffer of
+ * bounded size and returned by next() in their original order. Every frame
+ * is decoded to buffer not referenced by anyone else (recycled from the pool, if
+ * given), so it can be passed further without copying.
+ *
+ * When number of frames in the movie is unknown, only one thread is used. With more
+ * threads the chunk is shortened, so that the buffer holds a chunk for each of them,
+ * otherwise threads would wait for the consumer instead of decoding in parallel.
+ *
+ * With step greater than 1 only every step-th frame is decoded, frames in between
+ * are grabbed without decoding (or seeked over).
+ */
+class MovieDecoder {
+public:
+	MovieDecoder();
+
+	~MovieDecoder();
+
+	/*!
+	 * Starts decoding.
+	 *
+	 * \param filename movie file name
+	 * \param first index of the first frame of the segment
+	 * \param last index of the frame after the segment, negative - end of the movie
+	 * \param threads number of decoding threads
+	 * \param chunk number of consecutive frames decoded by one thread (at most buffer / threads, if threads > 1)
+	 * \param buffer maximum number of decoded frames waiting for next()
+	 * \param loop if set, segment is decoded over and over again
+	 * \param pool buffers for the decoded frames, NULL - every frame is allocated
+	 * \param step distance between decoded frames
+	 * \return false if movie couldn't be opened
+	 */
+	bool start(const std::string & filename, int first, int last, int threads, int chunk, int buffer, bool loop,
+			Types::FramePool * pool = NULL, int step = 1);
+
+	/*!
+	 * Stops decoding threads.
+	 */
+	void stop();
+
+	/// Returns true if decoding threads are running.
+	bool running() const;
+
+	/*!
+	 * Returns next frame of the segment, waiting for it if necessary.
+	 *
+	 * \param frame decoded frame
+	 * \param timestamp position of the frame in the movie, in seconds
+	 * \return false if there are no more frames
+	 */
+	bool next(cv::Mat & frame, double & timestamp);
+
+private:
+	struct Frame {
+		cv::Mat img;
+		double timestamp;
+	};
+
+	/// Decoding thread body.
+	void work();
+
+	/// Prepares buffer for the next frame (of given geometry).
+	void acquire(cv::Mat & img, cv::Size size, int type);
+
+	/// Returns true if frame with given ticket won't be ever decoded. Mutex must be held.
+	bool finished(long ticket) const;
+
+	std::string m_filename;
+
+	int m_first;
+
+	/// Number of frames in the segment, negative if unknown.
+	long m_length;
+
+	int m_chunk;
+
+	int m_buffer;
+
+	bool m_loop;
+
+	int m_step;
+
+	double m_fps;
+
+	Types::FramePool * m_pool;
+
+	/// Frames decoded so far, by ticket (number of the frame since start).
+	std::map<long, Frame> m_ready;
+
+	/// Next chunk to be decoded.
+	long m_next_chunk;
+
+	/// Ticket of the frame to be returned by next().
+	long m_consumed;
+
+	/// Ticket of the first frame past the end of the movie.
+	long m_end;
+
+	/// Number of threads still decoding.
+	int m_active;
+
+	bool m_stopping;
+
+	mutable boost::mutex m_mutex;
+
+	boost::condition_variable m_cond;
+
+	std::vector<boost::shared_ptr<boost::thread> > m_workers;
+};
+
+}//: namespace Movie
+}//: namespace Sources
+
+#endif /* MOVIE_DECODER_HPP_ */
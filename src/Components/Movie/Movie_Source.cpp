@@ -6,6 +6,7 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include "Movie_Source.hpp"
 
@@ -17,15 +18,44 @@ namespace Movie {
 
 Movie_Source::Movie_Source(const std::string & name) : Base::Component(name),
 		filename("filename", std::string("movie.avi")),
-		triggered("triggered", false)
+		triggered("triggered", false),
+		pacing_speed("pacing.speed", 0),
+		pacing_tolerance("pacing.tolerance", 0.05),
+		pacing_drop_late("pacing.drop_late", false),
+		loop("loop", true),
+		segment_start("segment.start", 0),
+		segment_end("segment.end", -1),
+		decoder_threads("decoder.threads", 0),
+		decoder_buffer("decoder.buffer", 8),
+		decoder_chunk("decoder.chunk", 16),
+		pool_size("pool.size", 16),
+		skip_every("skip.every", 1),
+		skip_adaptive("skip.adaptive", false)
 {
 	LOG(LTRACE) << "Movie_Source::Movie_Source()\n";
 
 //	cap = NULL;
 	trig = true;
+	frame_type = 0;
+	frames_read = 0;
+	skipped = 0;
+	ready_seen = false;
+	waiting_ready = false;
 
 	registerProperty(filename);
 	registerProperty(triggered);
+	registerProperty(pacing_speed);
+	registerProperty(pacing_tolerance);
+	registerProperty(pacing_drop_late);
+	registerProperty(loop);
+	registerProperty(segment_start);
+	registerProperty(segment_end);
+	registerProperty(decoder_threads);
+	registerProperty(decoder_buffer);
+	registerProperty(decoder_chunk);
+	registerProperty(pool_size);
+	registerProperty(skip_every);
+	registerProperty(skip_adaptive);
 }
 
 Movie_Source::~Movie_Source() {
@@ -39,6 +69,10 @@ void Movie_Source::prepareInterface() {
 
 	registerHandler("onStep", boost::bind(&Movie_Source::onStep, this));
 	addDependency("onStep", NULL);
+
+	registerStream("in_ready", &in_ready);
+	registerHandler("onReady", boost::bind(&Movie_Source::onReady, this));
+	addDependency("onReady", &in_ready);
 }
 
 bool Movie_Source::onInit() {
@@ -58,13 +92,61 @@ bool Movie_Source::onInit() {
 		return false;
 	}
 
+	fps = cap.get(CV_CAP_PROP_FPS);
+	if (fps <= 0)
+		fps = 25;
+
+	// Move to the beginning of the segment.
+	frame_number = std::max((int)segment_start, 0);
+	if (frame_number > 0)
+		cap.set(CV_CAP_PROP_POS_FRAMES, frame_number);
+
+	pool.setCapacity(std::max((int)pool_size, 0));
+	pool.resetCounters();
+
+	// Decode in background - the capture opened above is used only for probing.
+	if (decoder_threads > 0) {
+		cap.release();
+		if (!decoder.start(filename, segment_start, segment_end, decoder_threads, decoder_chunk, decoder_buffer, loop, &pool,
+				std::max((int)skip_every, 1))) {
+			LOG(LERROR) << "Couldn't start decoding of movie " << filename;
+			return false;
+		}
+	}
+
+	pacer.setSpeed(pacing_speed);
+	pacer.setTolerance(pacing_tolerance);
+	pacer.setDropLate(pacing_drop_late);
+	pacer.resetCounters();
+
+	frames_read = 0;
+	skipped = 0;
+	{
+		boost::mutex::scoped_lock lock(ready_mutex);
+		waiting_ready = false;
+	}
+
 	return true;
 }
 
 bool Movie_Source::onFinish() {
 	LOG(LTRACE) << "Movie_Source::finish()\n";
+	decoder.stop();
 	cap.release();
 
+	if (skipped > 0)
+		LOG(LINFO) << "Frames skipped without decoding: " << skipped;
+
+	if (pacing_speed > 0) {
+		LOG(LINFO) << "Paced frames: " << pacer.frames() << " late: " << pacer.late()
+				<< " dropped: " << pacer.dropped();
+	}
+
+	LOG(LINFO) << "Image buffers: " << pool.size() << " in use: " << pool.inUse()
+			<< " allocations: " << pool.allocations() << " of " << pool.requests()
+			<< " (" << pool.overflows() << " outside the pool)";
+	pool.clear();
+
 	return true;
 }
 
@@ -75,18 +157,107 @@ void Movie_Source::onStep() {
 	trig = false;
 
 	LOG(LTRACE) << "Movie_Source::step() start\n";
-	cap >> frame;
-	if (frame.empty()) {
-		cap.set(CV_CAP_PROP_POS_AVI_RATIO, 0);
-		cap >> frame;
+
+	// Every frame is decoded to buffer not referenced downstream, so it can be passed further without copying.
+	cv::Mat img;
+	double ts;
+	if (decoder.running()) {
+		// Decoder is held back by its bounded buffer, decimation is done by the decoder itself.
+		if (skip_adaptive && waitingReady())
+			return;
+		if (!decoder.next(img, ts))
+			return;
+	} else {
+		if (!grabFrame(ts))
+			return;
+
+		// Frames which won't be published are not decoded at all.
+		if (skipNext()) {
+			++skipped;
+			return;
+		}
+		if (pacing_speed > 0 && pacing_drop_late && pacer.overdue(ts)) {
+			LOG(LDEBUG) << "Movie_Source: frame late - skipped";
+			pacer.wait(ts);
+			++skipped;
+			return;
+		}
+
+		if (!retrieveFrame(img))
+			return;
 	}
 
-	cv::Mat img = frame.clone();
+	if (pacing_speed > 0 && !pacer.wait(ts)) {
+		LOG(LDEBUG) << "Movie_Source: frame late - dropped";
+		return;
+	}
+
+	// Set before publishing - token sent back for this frame can arrive before write returns.
+	{
+		boost::mutex::scoped_lock lock(ready_mutex);
+		waiting_ready = skip_adaptive && ready_seen;
+	}
 	out_img.write(img);
 
 	LOG(LTRACE) << "Movie_Source::step() end\n";
 }
 
+bool Movie_Source::grabFrame(double & ts) {
+	bool end = (segment_end >= 0 && frame_number >= segment_end);
+
+	if (end || !cap.grab()) {
+		if (!loop)
+			return false;
+
+		// Rewind to the beginning of the segment.
+		frame_number = std::max((int)segment_start, 0);
+		cap.set(CV_CAP_PROP_POS_FRAMES, frame_number);
+		if (!cap.grab())
+			return false;
+	}
+
+	// Position of the frame in the movie - backends that don't report it get constant frame rate.
+	ts = cap.get(CV_CAP_PROP_POS_MSEC) / 1000.0;
+	if (ts <= 0)
+		ts = frame_number / fps;
+	++frame_number;
+	++frames_read;
+
+	return true;
+}
+
+bool Movie_Source::retrieveFrame(cv::Mat & img) {
+	// Frame of the same geometry is decoded into recycled buffer.
+	img = pool.acquire(frame_size, frame_type);
+	if (!cap.retrieve(img) || img.empty())
+		return false;
+
+	frame_size = img.size();
+	frame_type = img.type();
+
+	return true;
+}
+
+bool Movie_Source::skipNext() {
+	if (skip_every > 1 && (frames_read - 1) % skip_every != 0)
+		return true;
+
+	return skip_adaptive && waitingReady();
+}
+
+bool Movie_Source::waitingReady() {
+	boost::mutex::scoped_lock lock(ready_mutex);
+	return waiting_ready;
+}
+
+void Movie_Source::onReady() {
+	in_ready.read();
+
+	boost::mutex::scoped_lock lock(ready_mutex);
+	ready_seen = true;
+	waiting_ready = false;
+}
+
 bool Movie_Source::onStart() {
 	return true;
 }
@@ -14,9 +14,16 @@
 #include "DataStream.hpp"
 #include "Property.hpp"
 
+#include "Types/PlaybackPacer.hpp"
+#include "Types/FramePool.hpp"
+
+#include "MovieDecoder.hpp"
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <boost/thread/mutex.hpp>
+
 /**
  * \defgroup Movie Movie
  * \ingroup Sources
@@ -28,6 +35,8 @@
  *
  * \streamout{out_img,cv::Mat}
  * Output image
+ * \streamin{in_ready,Base::UnitType}
+ * Token sent by the last component of the processing chain when it has finished with the frame
  *
  *
  * \par Events:
@@ -46,6 +55,40 @@
  *
  * \prop{filename,string,""}
  * Name of movie file
+ * \prop{loop,bool,true}
+ * If set, movie (segment) is played over and over again
+ * \prop{segment.start,int,0}
+ * Index of the first frame to play
+ * \prop{segment.end,int,-1}
+ * Index of the frame after the last one to play, -1 means end of the movie.
+ * Several Movie components can decode disjoint segments of one file in parallel.
+ * \prop{decoder.threads,int,0}
+ * Number of threads decoding frames in background, 0 - frames are decoded in onStep.
+ * With more than one thread each decodes chunks of frames (seeking to their beginning)
+ * and frames are reordered before publishing.
+ * \prop{decoder.buffer,int,8}
+ * Maximum number of decoded frames waiting for publishing. With more than one decoder thread
+ * it should hold decoder.chunk frames for each of them, otherwise the chunks are shortened
+ * to decoder.buffer / decoder.threads frames (so that all threads can decode at once).
+ * \prop{decoder.chunk,int,16}
+ * Number of consecutive frames decoded by one thread. Smaller chunks need smaller buffer
+ * (memory), but more seeking.
+ * \prop{pool.size,int,16}
+ * Number of image buffers recycled for consecutive frames. It should exceed decoder.buffer
+ * plus number of frames held downstream, otherwise images are allocated outside the pool.
+ * \prop{pacing.speed,double,0}
+ * Real-time replay - frames are published according to their position in the movie
+ * (with given speed multiplier). If set to 0, frames are published as fast as the executor runs.
+ * \prop{pacing.tolerance,double,0.05}
+ * Delay (in seconds) after which frame is treated as late
+ * \prop{pacing.drop_late,bool,false}
+ * If set, late frames are not published (nor decoded, if decoder.threads is 0)
+ * \prop{skip.every,int,1}
+ * Only every N-th frame is published, the others are skipped without decoding
+ * \prop{skip.adaptive,bool,false}
+ * If set, after publishing the image no frames are published until the token on in_ready arrives.
+ * Frames read in the meantime are skipped without decoding, background decoder is simply
+ * held back. Until the first token arrives all frames are published.
  *
  *
  * \see http://opencv.willowgarage.com/documentation/cpp/reading_and_writing_images_and_video.html#videocapture
@@ -109,19 +152,112 @@ protected:
 	 */
 	void onStep();
 
+	/*!
+	 * Event handler function - downstream is ready for the next frame.
+	 */
+	void onReady();
+
+	/*!
+	 * Grabs (without decoding) next frame of the segment in onStep, rewinding at its end (in loop mode).
+	 *
+	 * \return false if there are no more frames
+	 */
+	bool grabFrame(double & ts);
+
+	/*!
+	 * Decodes the frame grabbed by grabFrame.
+	 */
+	bool retrieveFrame(cv::Mat & img);
+
+	/// Returns true if the next frame shouldn't be published.
+	bool skipNext();
+
+	/// Returns true if downstream hasn't finished with the last published frame yet.
+	bool waitingReady();
+
 	/// Output data stream
 	Base::DataStreamOut<Mat> out_img;
 
+	/// Input data stream - downstream is ready for the next frame.
+	Base::DataStreamIn<Base::UnitType, Base::DataStreamBuffer::Newest> in_ready;
+
 	/// Capture device
 	VideoCapture cap;
 
-	/// Movie frame
-	Mat frame;
-
 	bool trig;
 
 	Base::Property<std::string> filename;
 	Base::Property<bool> triggered;
+
+	/// Playback speed multiplier, 0 - no pacing.
+	Base::Property<double> pacing_speed;
+
+	/// Delay after which frame is treated as late.
+	Base::Property<double> pacing_tolerance;
+
+	/// Drop late frames.
+	Base::Property<bool> pacing_drop_late;
+
+	/// Delays publishing of frames according to their timestamps.
+	Types::PlaybackPacer pacer;
+
+	/// Play in loop.
+	Base::Property<bool> loop;
+
+	/// First frame of the segment.
+	Base::Property<int> segment_start;
+
+	/// Frame after the segment.
+	Base::Property<int> segment_end;
+
+	/// Number of decoding threads.
+	Base::Property<int> decoder_threads;
+
+	/// Number of decoded frames waiting for publishing.
+	Base::Property<int> decoder_buffer;
+
+	/// Number of frames decoded at once by one thread.
+	Base::Property<int> decoder_chunk;
+
+	/// Number of recycled image buffers.
+	Base::Property<int> pool_size;
+
+	/// Buffers for the decoded frames.
+	Types::FramePool pool;
+
+	/// Background decoder.
+	MovieDecoder decoder;
+
+	/// Movie frame rate, used if backend doesn't report frame positions.
+	double fps;
+
+	/// Index of the next frame read in onStep.
+	long frame_number;
+
+	/// Publish only every N-th frame.
+	Base::Property<int> skip_every;
+
+	/// Skip frames until downstream is ready.
+	Base::Property<bool> skip_adaptive;
+
+	/// Number of frames read since start, for decimation.
+	unsigned long frames_read;
+
+	/// Number of frames skipped without decoding.
+	unsigned long skipped;
+
+	/// Set when the first token on in_ready arrives.
+	bool ready_seen;
+
+	/// Set after publishing the image, until downstream is ready.
+	bool waiting_ready;
+
+	/// Protects ready_seen and waiting_ready - onReady can run in another thread.
+	boost::mutex ready_mutex;
+
+	/// Geometry of the last frame read in onStep.
+	cv::Size frame_size;
+	int frame_type;
 };
 
 }//: namespace Movie
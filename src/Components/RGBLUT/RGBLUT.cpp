@@ -9,6 +9,8 @@
 
 #include "RGBLUT.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 #include <boost/bind.hpp>
 
@@ -22,7 +24,10 @@ RGBLUT::RGBLUT(const std::string & name) :
 		m_green_threshold_low("green.threshold.low", 0, "range"),
 		m_green_threshold_high("green.threshold.high", 255, "range"),
 		m_blue_threshold_low("blue.threshold.low", 0, "range"),
-		m_blue_threshold_high("blue.threshold.high", 255, "range")
+		m_blue_threshold_high("blue.threshold.high", 255, "range"),
+		m_lut("lut", false),
+		m_classes("classes", std::string("")),
+		m_threads("threads", 1)
 {
 	// Constraints.
 	m_red_threshold_low.addConstraint("0");
@@ -47,6 +52,13 @@ RGBLUT::RGBLUT(const std::string & name) :
 	registerProperty(m_blue_threshold_low);
 	registerProperty(m_blue_threshold_high);
 
+	m_lut.setToolTip("Classify pixels with precomputed lookup table");
+	registerProperty(m_lut);
+	m_classes.setToolTip("Additional classes: low-high,low-high,low-high;...");
+	registerProperty(m_classes);
+	m_threads.setToolTip("Number of threads processing the image (0 - all cores)");
+	registerProperty(m_threads);
+
 	LOG(LTRACE) << "Hello RGBLUT\n";
 }
 
@@ -59,6 +71,7 @@ void RGBLUT::prepareInterface() {
 
 	registerStream("in_img", &in_img);
 	registerStream("out_img", &out_img);
+	registerStream("out_labels", &out_labels);
 
 	// Add default dependency of the onNewImage.
 	addDependency("onNewImage", &in_img);
@@ -81,55 +94,55 @@ bool RGBLUT::onStart() {
 	return true;
 }
 
+void RGBLUT::processRows(const cv::Range & rows, const cv::Mat & src)
+{
+	cv::Mat mask_band = tmp_img.rowRange(rows);
+	if (m_lut) {
+		cv::Mat labels_band = labels.rowRange(rows);
+		lut.apply(src.rowRange(rows), labels_band, &mask_band);
+	} else {
+		mask.apply(src.rowRange(rows), mask_band);
+	}
+}
+
 void RGBLUT::onNewImage()
 {
 	LOG(LTRACE) << "RGBLUT::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat rgb_img = in_img.read();
-
-		cv::Size size = rgb_img.size();
-
-		tmp_img.create(size, CV_8UC1);
-
-		// Check the arrays for continuity and, if this is the case,
-		// treat the arrays as 1D vectors
-		if (rgb_img.isContinuous() && tmp_img.isContinuous()) {
-			size.width *= size.height;
-			size.height = 1;
-		}
-		size.width *= 3;
-
-		for (int i = 0; i < size.height; i++) {
-			// when the arrays are continuous,
-			// the outer loop is executed only once
-			// if not - it's executed for each row
-			const uchar* rgb_p = rgb_img.ptr <uchar> (i);
-			uchar* tmp_p = tmp_img.ptr <uchar> (i);
-
-			int j, k = 0;
-			for (j = 0; j < size.width; j += 3) {
-				uchar r = rgb_p[j];
-				uchar g = rgb_p[j + 1];
-				uchar b = rgb_p[j + 2];
-
-				uchar val = 255;
-				//  Red.
-				if ((r < m_red_threshold_low) || (r > m_red_threshold_high))
-					val = 0;
-				//  Green.
-				else if ((g < m_green_threshold_low) || (g > m_green_threshold_high))
-					val = 0;
-				//  blue.
-				else if ((b < m_blue_threshold_low) || (b > m_blue_threshold_high))
-					val = 0;
-
-				tmp_p[k] = val;
-
-				++k;
+		probe.bytesIn(rgb_img);
+
+		// All channels are compared at once, with vector instructions if available.
+		mask.setRange(0, m_red_threshold_low, m_red_threshold_high);
+		mask.setRange(1, m_green_threshold_low, m_green_threshold_high);
+		mask.setRange(2, m_blue_threshold_low, m_blue_threshold_high);
+
+		if (m_lut) {
+			// First class is given by the thresholds, table is rebuilt only if any class has changed.
+			// Malformed list is reported once, when it is set.
+			std::string error;
+			if (class_list.update(m_classes, error) && !error.empty())
+				LOG(LERROR) << name() << ": invalid classes - " << error;
+			std::vector<Types::RangeMask> classes = class_list.classes();
+			classes.insert(classes.begin(), mask);
+			if (lut.setClasses(classes)) {
+				LOG(LINFO) << name() << ": lookup table rebuilt for " << lut.classes() << " classes";
+				if (classes.size() > lut.classes())
+					LOG(LWARNING) << name() << ": " << classes.size() << " classes given, only the first "
+							<< lut.classes() << " are used";
 			}
+			labels.create(rgb_img.size(), CV_8UC1);
 		}
+		tmp_img.create(rgb_img.size(), CV_8UC1);
+
+		Types::parallelRows(rgb_img.rows, m_threads, boost::bind(&RGBLUT::processRows, this, _1, boost::cref(rgb_img)));
+
+		if (m_lut)
+			out_labels.write(labels);
 
 		// Write output to stream.
+		probe.bytesOut(tmp_img);
 		out_img.write(tmp_img);
 	}
 	catch (Common::DisCODeException& ex) {
@@ -140,6 +153,9 @@ void RGBLUT::onNewImage()
 	catch (const char * ex) {
 		LOG(LERROR) << ex;
 	}
+	catch (std::exception & ex) {
+		LOG(LERROR) << "RGBLUT::onNewImage failed: " << ex.what();
+	}
 	catch (...) {
 		LOG(LERROR) << "RGBLUT::onNewImage failed\n";
 	}
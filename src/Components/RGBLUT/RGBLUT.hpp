@@ -16,6 +16,9 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "Types/RangeMask.hpp"
+#include "Types/ColorLUT.hpp"
+
 
 namespace Processors {
 namespace RGBLUT {
@@ -24,7 +27,15 @@ namespace RGBLUT {
  * \class RGBLUT
  * \brief RGBLUT processor class.
  *
- * RGBLUT processor.
+ * RGBLUT processor - marks pixels with red, green and blue components within given ranges.
+ * Range with low > high matches nothing (only hue ranges of HSVLUT wrap around).
+ *
+ * In lookup table mode (lut property) pixels are classified with precomputed table of all
+ * colours, which is rebuilt only when thresholds change. Thresholds define the first class,
+ * next ones can be given in classes property ("low-high,low-high,low-high;..."), and
+ * out_labels receives the number of the first matching class of every pixel (0 - none).
+ *
+ * Bands of rows can be processed in parallel, by threads number of threads.
  */
 class RGBLUT: public Base::Component {
 public:
@@ -72,15 +83,32 @@ protected:
 	 */
 	void onNewImage();
 
+	/// Classifies given rows of the input.
+	void processRows(const cv::Range & rows, const cv::Mat & src);
+
 	/// Input image
 	Base::DataStreamIn <cv::Mat> in_img;
 
 	/// Output data stream - image.
 	Base::DataStreamOut <cv::Mat> out_img;
 
+	/// Output data stream - labels of classes (in lookup table mode).
+	Base::DataStreamOut <cv::Mat> out_labels;
+
 private:
 	cv::Mat tmp_img;
 
+	/// Thresholding of all channels.
+	Types::RangeMask mask;
+
+	/// Lookup table of colour classes.
+	Types::ColorLUT lut;
+
+	/// Additional classes, parsed from the classes property.
+	Types::ColorClassList class_list;
+
+	cv::Mat labels;
+
 	Base::Property<int> m_red_threshold_low;
 	Base::Property<int> m_red_threshold_high;
 	Base::Property<int> m_green_threshold_low;
@@ -88,6 +116,15 @@ private:
 	Base::Property<int> m_blue_threshold_low;
 	Base::Property<int> m_blue_threshold_high;
 
+	/// Classify with lookup table.
+	Base::Property<bool> m_lut;
+
+	/// Additional classes (lookup table mode).
+	Base::Property<std::string> m_classes;
+
+	/// Number of threads.
+	Base::Property<int> m_threads;
+
 };
 
 } //: namespace RGBLUT
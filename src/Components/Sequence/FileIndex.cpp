@@ -0,0 +1,247 @@
+/*!
+ * \file FileIndex.cpp
+ * \brief Searching for files of the sequence - functions definition.
+ */
+
+#include "FileIndex.hpp"
+
+#include "Component_Aux.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace Sources {
+namespace Sequence {
+
+namespace {
+
+/*!
+ * Returns name of the index file of the directory, in the user's cache directory
+ * (created if needed), empty if there is no cache directory.
+ */
+std::string indexFile(const std::string & directory) {
+	namespace fs = boost::filesystem;
+
+	fs::path cache;
+	if (const char * xdg = std::getenv("XDG_CACHE_HOME"))
+		cache = xdg;
+	else if (const char * home = std::getenv("HOME"))
+		cache = fs::path(home) / ".cache";
+	else
+		return std::string();
+
+	cache /= "discode/sequence_index";
+	try {
+		fs::create_directories(cache);
+	} catch (...) {
+		return std::string();
+	}
+
+	char name[32];
+	std::sprintf(name, "%016llx", (unsigned long long)boost::hash_value(directory));
+	return (cache / name).string();
+}
+
+}
+
+std::vector<std::string> searchFiles(const std::string & directory, const std::string & pattern, bool use_cache) {
+	namespace fs = boost::filesystem;
+
+	if (!use_cache)
+		return Utils::searchFiles(directory, pattern);
+
+	std::string path, index;
+	std::time_t mtime;
+	try {
+		path = fs::absolute(directory).string();
+		index = indexFile(path);
+		mtime = fs::last_write_time(directory);
+	} catch (...) {
+		return Utils::searchFiles(directory, pattern);
+	}
+	if (index.empty())
+		return Utils::searchFiles(directory, pattern);
+
+	// Index is valid for the same directory, its state and pattern. Directory modified
+	// in the same second as the index was created might have changed after the search.
+	std::ifstream in(index.c_str());
+	if (in) {
+		std::string idx_path, idx_pattern, idx_mtime, idx_created;
+		std::getline(in, idx_path);
+		std::getline(in, idx_pattern);
+		std::getline(in, idx_mtime);
+		std::getline(in, idx_created);
+		if (idx_path == path && idx_pattern == pattern && idx_mtime == boost::lexical_cast<std::string>(mtime) &&
+				std::atol(idx_created.c_str()) > mtime) {
+			std::vector<std::string> files;
+			std::string fname;
+			while (std::getline(in, fname))
+				if (!fname.empty())
+					files.push_back(fname);
+			LOG(LDEBUG) << "Using file index " << index;
+			return files;
+		}
+	}
+	in.close();
+
+	std::time_t created = std::time(NULL);
+	std::vector<std::string> files = Utils::searchFiles(directory, pattern);
+
+	std::ofstream out(index.c_str(), std::ios::trunc);
+	if (!out) {
+		LOG(LDEBUG) << "Couldn't create file index " << index;
+		return files;
+	}
+	out << path << "\n" << pattern << "\n" << mtime << "\n" << created << "\n";
+	for (size_t i = 0; i < files.size(); ++i)
+		out << files[i] << "\n";
+
+	return files;
+}
+
+std::vector<std::string> searchShardedFiles(const std::string & directory, const std::string & pattern, bool use_cache) {
+	namespace fs = boost::filesystem;
+
+	std::vector<std::string> files = searchFiles(directory, pattern, use_cache);
+
+	std::vector<std::string> shards;
+	for (fs::directory_iterator it(directory), end; it != end; ++it)
+		if (fs::is_directory(it->status()))
+			shards.push_back(it->path().string());
+	std::sort(shards.begin(), shards.end());
+
+	for (size_t i = 0; i < shards.size(); ++i) {
+		std::vector<std::string> found = searchFiles(shards[i], pattern, use_cache);
+		files.insert(files.end(), found.begin(), found.end());
+	}
+
+	return files;
+}
+
+bool naturalLess(const std::string & a, const std::string & b) {
+	size_t i = 0, j = 0;
+
+	while (i < a.size() && j < b.size()) {
+		if (!std::isdigit((unsigned char)a[i]) || !std::isdigit((unsigned char)b[j])) {
+			if (a[i] != b[j])
+				return (unsigned char)a[i] < (unsigned char)b[j];
+			++i;
+			++j;
+			continue;
+		}
+
+		// Skip leading zeros.
+		size_t si = i, sj = j;
+		while (si < a.size() && a[si] == '0')
+			++si;
+		while (sj < b.size() && b[sj] == '0')
+			++sj;
+
+		size_t ei = si, ej = sj;
+		while (ei < a.size() && std::isdigit((unsigned char)a[ei]))
+			++ei;
+		while (ej < b.size() && std::isdigit((unsigned char)b[ej]))
+			++ej;
+
+		// Longer number is bigger, same length numbers are compared digit by digit.
+		if (ei - si != ej - sj)
+			return (ei - si) < (ej - sj);
+		int cmp = a.compare(si, ei - si, b, sj, ej - sj);
+		if (cmp != 0)
+			return cmp < 0;
+
+		// Equal values - shorter notation goes first.
+		if (si - i != sj - j)
+			return (si - i) < (sj - j);
+
+		i = ei;
+		j = ej;
+	}
+
+	return (a.size() - i) < (b.size() - j);
+}
+
+bool timestampFromName(const std::string & fname, double scale, double & timestamp) {
+	std::string stem = boost::filesystem::path(fname).stem().string();
+
+	// ISO extended time, e.g. 2014-05-12T10:20:30.123456
+	if (stem.size() >= 19 && stem[4] == '-' && stem[7] == '-' && stem[10] == 'T') {
+		size_t end = stem.find_first_not_of("0123456789-T:.,");
+		std::string iso = stem.substr(0, end);
+		iso[10] = ' ';
+		try {
+			boost::posix_time::ptime t = boost::posix_time::time_from_string(iso);
+			boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+			timestamp = (t - epoch).total_microseconds() / 1e6;
+			return true;
+		} catch (...) {
+			// Not a time - try plain number.
+		}
+	}
+
+	size_t last = stem.find_last_of("0123456789");
+	if (last == std::string::npos)
+		return false;
+
+	size_t first = last;
+	bool dot = false;
+	while (first > 0) {
+		char c = stem[first - 1];
+		if (std::isdigit((unsigned char)c)) {
+			--first;
+		} else if (c == '.' && !dot && first > 1 && std::isdigit((unsigned char)stem[first - 2])) {
+			dot = true;
+			--first;
+		} else {
+			break;
+		}
+	}
+
+	timestamp = std::strtod(stem.substr(first, last - first + 1).c_str(), NULL) * scale;
+	return true;
+}
+
+size_t matchStems(std::vector<std::vector<std::string> > & lists) {
+	if (lists.size() < 2)
+		return 0;
+
+	// Stems of the other directories.
+	std::vector<std::map<std::string, std::string> > stems(lists.size());
+	for (size_t k = 1; k < lists.size(); ++k) {
+		for (size_t i = 0; i < lists[k].size(); ++i)
+			stems[k].insert(std::make_pair(boost::filesystem::path(lists[k][i]).stem().string(), lists[k][i]));
+	}
+
+	std::vector<std::vector<std::string> > matched(lists.size());
+	for (size_t i = 0; i < lists[0].size(); ++i) {
+		std::string stem = boost::filesystem::path(lists[0][i]).stem().string();
+
+		size_t k = 1;
+		while (k < lists.size() && stems[k].count(stem))
+			++k;
+		if (k < lists.size())
+			continue;
+
+		matched[0].push_back(lists[0][i]);
+		for (k = 1; k < lists.size(); ++k)
+			matched[k].push_back(stems[k][stem]);
+	}
+
+	size_t removed = lists[0].size() - matched[0].size();
+	lists.swap(matched);
+	return removed;
+}
+
+}//: namespace Sequence
+}//: namespace Sources
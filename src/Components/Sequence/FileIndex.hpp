@@ -0,0 +1,61 @@
+/*!
+ * \file FileIndex.hpp
+ * \brief Searching for files of the sequence - functions declaration.
+ */
+
+#ifndef SEQUENCE_FILEINDEX_HPP_
+#define SEQUENCE_FILEINDEX_HPP_
+
+#include <vector>
+#include <string>
+
+namespace Sources {
+namespace Sequence {
+
+/*!
+ * Returns files from the directory matching given pattern (regular expression).
+ *
+ * If use_cache is set, the list is stored in index file in the user's cache directory
+ * (nothing is written to the searched directory) and reused as long as the directory
+ * modification time doesn't change. Modification time has resolution of one second, so
+ * the index is trusted only if it was created after the second of the last modification.
+ * When the index can't be written, files are simply searched.
+ */
+std::vector<std::string> searchFiles(const std::string & directory, const std::string & pattern, bool use_cache);
+
+/*!
+ * Same as searchFiles, but searches also in all immediate subdirectories (shards),
+ * taken in the order of their names.
+ */
+std::vector<std::string> searchShardedFiles(const std::string & directory, const std::string & pattern, bool use_cache);
+
+/*!
+ * Natural order of strings - runs of digits are compared by their numeric value,
+ * so that "img2.png" comes before "img10.png".
+ */
+bool naturalLess(const std::string & a, const std::string & b);
+
+/*!
+ * Extracts capture timestamp (in seconds) from the file name. Names starting with
+ * ISO time (as produced by ImageWriter, e.g. 2014-05-12T10:20:30.123456_img.png)
+ * are converted to seconds since epoch, otherwise the last number in the name
+ * (possibly with fractional part) multiplied by scale is used.
+ *
+ * \return false if name doesn't contain any number
+ */
+bool timestampFromName(const std::string & fname, double scale, double & timestamp);
+
+/*!
+ * Matches files of several directories by their names without extension (e.g.
+ * rgb/0001.png with depth/0001.yml). Files of the first list without counterparts
+ * in all other lists are removed, other lists are reordered so that matched files
+ * share the same index.
+ *
+ * \return number of files removed from the first list
+ */
+size_t matchStems(std::vector<std::vector<std::string> > & lists);
+
+}//: namespace Sequence
+}//: namespace Sources
+
+#endif /* SEQUENCE_FILEINDEX_HPP_ */
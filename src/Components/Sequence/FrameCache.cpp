@@ -0,0 +1,174 @@
+/*!
+ * \file FrameCache.cpp
+ * \brief Memory-bounded cache of sequence images - methods definition.
+ */
+
+#include "FrameCache.hpp"
+#include "Prefetcher.hpp"
+#include "Logger.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace Sources {
+namespace Sequence {
+
+FrameCache::FrameCache() :
+	m_budget(0), m_bytes(0), m_hits(0), m_misses(0), m_evictions(0) {
+}
+
+void FrameCache::setBudget(size_t budget) {
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_budget = budget;
+	while (m_bytes > m_budget && !m_lru.empty())
+		evictOne();
+}
+
+int FrameCache::preload(const std::vector<std::string> & files, int threads) {
+	if (threads < 1)
+		threads = boost::thread::hardware_concurrency();
+	if (threads < 1)
+		threads = 1;
+
+	int next = 0;
+	bool full = false;
+	int loaded = 0;
+
+	boost::thread_group workers;
+	for (int i = 0; i < threads; ++i)
+		workers.create_thread(boost::bind(&FrameCache::preloadWorker, this, &files, &next, &full, &loaded));
+	workers.join_all();
+
+	return loaded;
+}
+
+void FrameCache::preloadWorker(const std::vector<std::string> * files, int * next, bool * full, int * loaded) {
+	for (;;) {
+		int idx;
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			if (*full || *next >= (int)files->size())
+				return;
+			idx = (*next)++;
+		}
+
+		if ((*files)[idx].empty())
+			continue;
+
+		cv::Mat img;
+		try {
+			img = loadImage((*files)[idx]);
+		} catch (...) {
+			LOG(LWARNING) << "Preloading of image failed! [" << (*files)[idx] << "]";
+			continue;
+		}
+
+		if (img.empty())
+			continue;
+
+		if (!put(idx, img, false)) {
+			boost::mutex::scoped_lock lock(m_mutex);
+			*full = true;
+			return;
+		}
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		++(*loaded);
+	}
+}
+
+bool FrameCache::get(int index, cv::Mat & img) {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	std::map<int, Entry>::iterator it = m_entries.find(index);
+	if (it == m_entries.end()) {
+		++m_misses;
+		return false;
+	}
+
+	// Mark as most recently used.
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+
+	img = it->second.img;
+	++m_hits;
+	return true;
+}
+
+bool FrameCache::put(int index, const cv::Mat & img, bool evict) {
+	size_t bytes = img.total() * img.elemSize();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	if (bytes > m_budget)
+		return false;
+
+	std::map<int, Entry>::iterator it = m_entries.find(index);
+	if (it != m_entries.end()) {
+		m_bytes -= it->second.bytes;
+		m_lru.erase(it->second.lru);
+		m_entries.erase(it);
+	}
+
+	if (!evict && m_bytes + bytes > m_budget)
+		return false;
+
+	while (m_bytes + bytes > m_budget && !m_lru.empty())
+		evictOne();
+
+	m_lru.push_front(index);
+	Entry & entry = m_entries[index];
+	entry.img = img;
+	entry.bytes = bytes;
+	entry.lru = m_lru.begin();
+	m_bytes += bytes;
+
+	return true;
+}
+
+void FrameCache::clear() {
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_entries.clear();
+	m_lru.clear();
+	m_bytes = 0;
+	m_hits = 0;
+	m_misses = 0;
+	m_evictions = 0;
+}
+
+size_t FrameCache::bytes() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_bytes;
+}
+
+size_t FrameCache::size() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+unsigned long FrameCache::hits() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_hits;
+}
+
+unsigned long FrameCache::misses() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_misses;
+}
+
+unsigned long FrameCache::evictions() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_evictions;
+}
+
+void FrameCache::evictOne() {
+	int index = m_lru.back();
+	m_lru.pop_back();
+
+	std::map<int, Entry>::iterator it = m_entries.find(index);
+	m_bytes -= it->second.bytes;
+	m_entries.erase(it);
+	++m_evictions;
+}
+
+}//: namespace Sequence
+}//: namespace Sources
@@ -0,0 +1,114 @@
+/*!
+ * \file FrameCache.hpp
+ * \brief Memory-bounded cache of sequence images - class declaration.
+ */
+
+#ifndef SEQUENCE_FRAMECACHE_HPP_
+#define SEQUENCE_FRAMECACHE_HPP_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <list>
+
+#include <boost/thread/mutex.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Sources {
+namespace Sequence {
+
+/*!
+ * \class FrameCache
+ * \brief Keeps decoded images of the sequence in memory, up to given number of bytes.
+ *
+ * When the budget is exceeded least recently used images are evicted.
+ * All methods are thread safe.
+ */
+class FrameCache {
+public:
+	FrameCache();
+
+	/*!
+	 * Sets memory budget (in bytes) and evicts images, if necessary.
+	 */
+	void setBudget(size_t budget);
+
+	/*!
+	 * Decodes files of the sequence using given number of threads, until
+	 * all of them are loaded or the memory budget is used up. Nothing is evicted.
+	 *
+	 * \param threads number of threads, 0 means one thread per core
+	 * \return number of images loaded
+	 */
+	int preload(const std::vector<std::string> & files, int threads);
+
+	/*!
+	 * Returns image with given index and marks it as recently used.
+	 *
+	 * \return true if image was found in cache
+	 */
+	bool get(int index, cv::Mat & img);
+
+	/*!
+	 * Puts image to cache.
+	 *
+	 * \param evict if set, least recently used images are removed to make room for the new one,
+	 * otherwise image is stored only if it fits into free space
+	 * \return true if image was stored
+	 */
+	bool put(int index, const cv::Mat & img, bool evict = true);
+
+	/// Removes all images.
+	void clear();
+
+	/// Number of bytes occupied by cached images.
+	size_t bytes() const;
+
+	/// Number of cached images.
+	size_t size() const;
+
+	/// Number of successful lookups.
+	unsigned long hits() const;
+
+	/// Number of failed lookups.
+	unsigned long misses() const;
+
+	/// Number of evicted images.
+	unsigned long evictions() const;
+
+private:
+	/// Preloading thread body.
+	void preloadWorker(const std::vector<std::string> * files, int * next, bool * full, int * loaded);
+
+	/// Removes least recently used image. Mutex must be held by the caller.
+	void evictOne();
+
+	struct Entry {
+		cv::Mat img;
+		size_t bytes;
+		std::list<int>::iterator lru;
+	};
+
+	std::map<int, Entry> m_entries;
+
+	/// Indices ordered from the most recently used.
+	std::list<int> m_lru;
+
+	size_t m_budget;
+
+	size_t m_bytes;
+
+	unsigned long m_hits;
+
+	unsigned long m_misses;
+
+	unsigned long m_evictions;
+
+	mutable boost::mutex m_mutex;
+};
+
+}//: namespace Sequence
+}//: namespace Sources
+
+#endif /* SEQUENCE_FRAMECACHE_HPP_ */
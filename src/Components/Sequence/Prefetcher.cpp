@@ -0,0 +1,180 @@
+/*!
+ * \file Prefetcher.cpp
+ * \brief Background loader of sequence images - methods definition.
+ */
+
+#include "Prefetcher.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+
+#include <opencv2/highgui/highgui.hpp>
+
+#include <boost/bind.hpp>
+
+namespace Sources {
+namespace Sequence {
+
+cv::Mat loadImage(const std::string & fname) {
+	cv::Mat img;
+
+	if (fname.empty())
+		return img;
+
+	// Get file extension.
+	std::string ext = fname.substr(fname.rfind(".")+1);
+
+	// Read depth from yaml.
+	if ((ext == "xml") || (ext == "yaml") || (ext == "yml") || (ext == "gz")){
+		cv::FileStorage file(fname, cv::FileStorage::READ);
+		file["img"] >> img;
+	}
+	else
+		img = cv::imread(fname, CV_LOAD_IMAGE_ANYDEPTH | CV_LOAD_IMAGE_ANYCOLOR);
+
+	return img;
+}
+
+Prefetcher::Prefetcher() : m_stopping(false), m_hits(0), m_misses(0) {
+}
+
+Prefetcher::~Prefetcher() {
+	stop();
+}
+
+void Prefetcher::start(const std::vector<std::string> & files, int threads) {
+	stop();
+
+	m_files = files;
+	m_hits = 0;
+	m_misses = 0;
+
+	if (threads < 1)
+		threads = 1;
+
+	for (int i = 0; i < threads; ++i)
+		m_workers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&Prefetcher::work, this))));
+}
+
+void Prefetcher::stop() {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_stopping = true;
+		m_queue.clear();
+	}
+	m_cond.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); ++i)
+		m_workers[i]->join();
+	m_workers.clear();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_ready.clear();
+	m_loading.clear();
+	m_window.clear();
+	m_stopping = false;
+}
+
+bool Prefetcher::running() const {
+	return !m_workers.empty();
+}
+
+void Prefetcher::schedule(const std::vector<int> & indices) {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		m_window.clear();
+		m_window.insert(indices.begin(), indices.end());
+
+		// Drop images that left the window.
+		std::map<int, cv::Mat>::iterator it = m_ready.begin();
+		while (it != m_ready.end()) {
+			if (m_window.count(it->first))
+				++it;
+			else
+				m_ready.erase(it++);
+		}
+
+		m_queue.clear();
+		for (size_t i = 0; i < indices.size(); ++i) {
+			int idx = indices[i];
+			if (idx < 0 || idx >= (int)m_files.size())
+				continue;
+			if (m_files[idx].empty() || m_ready.count(idx) || m_loading.count(idx))
+				continue;
+			m_queue.push_back(idx);
+		}
+	}
+	m_cond.notify_all();
+}
+
+bool Prefetcher::fetch(int index, cv::Mat & img) {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	for (;;) {
+		std::map<int, cv::Mat>::iterator it = m_ready.find(index);
+		if (it != m_ready.end()) {
+			img = it->second;
+			++m_hits;
+			return true;
+		}
+
+		// Decode already in progress - wait for it.
+		if (!m_loading.count(index))
+			break;
+		m_cond.wait(lock);
+	}
+
+	// Not started yet - caller loads it by itself.
+	std::deque<int>::iterator qit = std::find(m_queue.begin(), m_queue.end(), index);
+	if (qit != m_queue.end())
+		m_queue.erase(qit);
+
+	++m_misses;
+	return false;
+}
+
+unsigned long Prefetcher::hits() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_hits;
+}
+
+unsigned long Prefetcher::misses() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_misses;
+}
+
+void Prefetcher::work() {
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	while (!m_stopping) {
+		if (m_queue.empty()) {
+			m_cond.wait(lock);
+			continue;
+		}
+
+		int idx = m_queue.front();
+		m_queue.pop_front();
+		m_loading.insert(idx);
+		std::string fname = m_files[idx];
+
+		lock.unlock();
+		cv::Mat img;
+		try {
+			img = loadImage(fname);
+		} catch (...) {
+			LOG(LWARNING) << "Prefetching of image failed! [" << fname << "]";
+		}
+		lock.lock();
+
+		m_loading.erase(idx);
+		// Window could have moved in the meantime.
+		if (m_window.count(idx))
+			m_ready[idx] = img;
+
+		m_cond.notify_all();
+	}
+}
+
+}//: namespace Sequence
+}//: namespace Sources
@@ -0,0 +1,116 @@
+/*!
+ * \file Prefetcher.hpp
+ * \brief Background loader of sequence images - class declaration.
+ */
+
+#ifndef SEQUENCE_PREFETCHER_HPP_
+#define SEQUENCE_PREFETCHER_HPP_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Sources {
+namespace Sequence {
+
+/*!
+ * Loads single image from file. Images stored in xml/yaml files (optionally
+ * gzipped) are read with cv::FileStorage (from "img" node), all others with cv::imread.
+ *
+ * \param fname name of the file
+ * \return loaded image, empty if file couldn't be read (or name is empty)
+ */
+cv::Mat loadImage(const std::string & fname);
+
+/*!
+ * \class Prefetcher
+ * \brief Loads images of the sequence in background, before they are requested.
+ *
+ * Indices passed to schedule() form the read-ahead window - they are decoded by
+ * the pool of worker threads and kept in memory, everything outside the window
+ * is dropped. Subsequent fetch() of an index from the window is served from memory
+ * (waiting for the decode if it is already in progress).
+ */
+class Prefetcher {
+public:
+	Prefetcher();
+
+	~Prefetcher();
+
+	/*!
+	 * Starts worker threads for given list of files. Previously started workers are stopped.
+	 */
+	void start(const std::vector<std::string> & files, int threads);
+
+	/*!
+	 * Stops worker threads and drops all loaded images.
+	 */
+	void stop();
+
+	/// Returns true if worker threads are running.
+	bool running() const;
+
+	/*!
+	 * Sets read-ahead window. Images are loaded in the order of given indices.
+	 */
+	void schedule(const std::vector<int> & indices);
+
+	/*!
+	 * Returns image with given index, if it was (or is being) loaded in background.
+	 *
+	 * \return true on hit, false if image has to be loaded by the caller
+	 */
+	bool fetch(int index, cv::Mat & img);
+
+	/// Number of images served from memory.
+	unsigned long hits() const;
+
+	/// Number of images which had to be loaded by the caller.
+	unsigned long misses() const;
+
+private:
+	/// Worker thread body.
+	void work();
+
+	/// Copy of the sequence file list.
+	std::vector<std::string> m_files;
+
+	/// Images already loaded.
+	std::map<int, cv::Mat> m_ready;
+
+	/// Images being loaded at the moment.
+	std::set<int> m_loading;
+
+	/// Images waiting for the worker.
+	std::deque<int> m_queue;
+
+	/// Current read-ahead window.
+	std::set<int> m_window;
+
+	mutable boost::mutex m_mutex;
+
+	/// Signalled when new work is queued or image is loaded.
+	boost::condition_variable m_cond;
+
+	std::vector<boost::shared_ptr<boost::thread> > m_workers;
+
+	bool m_stopping;
+
+	unsigned long m_hits;
+
+	unsigned long m_misses;
+};
+
+}//: namespace Sequence
+}//: namespace Sources
+
+#endif /* SEQUENCE_PREFETCHER_HPP_ */
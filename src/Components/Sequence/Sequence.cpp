@@ -6,8 +6,19 @@
 
 #include "Sequence.hpp"
 
+#include "FileIndex.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 #include <opencv2/highgui/highgui.hpp>
 
+#include "Types/ParallelFor.hpp"
+
 namespace Sources {
 namespace Sequence {
 
@@ -15,24 +26,59 @@ Sequence::Sequence(const std::string & n) :
 	Base::Component(n),
 	prop_directory("sequence.directory", std::string(".")),
 	prop_pattern("sequence.pattern", std::string(".*\\.(jpg|png|bmp|yaml|yml)")),
+	prop_match("sequence.match", std::string("index")),
+	prop_sharded("sequence.sharded", false),
 	prop_sort("mode.sort", true),
 	prop_loop("mode.loop", false),
 	prop_auto_publish_image("mode.auto_publish_image", true),
 	prop_auto_next_image("mode.auto_next_image", true),
-	prop_auto_prev_image("mode.auto_prev_image", false)
+	prop_auto_prev_image("mode.auto_prev_image", false),
+	prop_natural_sort("mode.natural_sort", false),
+	prop_index_cache("sequence.index_cache", false),
+	prop_prefetch_frames("prefetch.frames", 0),
+	prop_prefetch_threads("prefetch.threads", 1),
+	prop_preload("mode.preload", false),
+	prop_preload_budget("preload.budget", 1024),
+	prop_preload_threads("preload.threads", 0),
+	prop_pacing_speed("pacing.speed", 0),
+	prop_pacing_source("pacing.source", std::string("fps")),
+	prop_pacing_fps("pacing.fps", 25),
+	prop_pacing_timestamp_scale("pacing.timestamp_scale", 1),
+	prop_pacing_timestamps_file("pacing.timestamps_file", std::string("")),
+	prop_pacing_tolerance("pacing.tolerance", 0.05),
+	prop_pacing_drop_late("pacing.drop_late", false)
 {
 	registerProperty(prop_directory);
 	registerProperty(prop_pattern);
+	registerProperty(prop_match);
+	registerProperty(prop_sharded);
 	registerProperty(prop_sort);
 	registerProperty(prop_loop);
 	registerProperty(prop_auto_publish_image);
 	registerProperty(prop_auto_next_image);
 	registerProperty(prop_auto_prev_image);
+	registerProperty(prop_prefetch_frames);
+	registerProperty(prop_prefetch_threads);
+	registerProperty(prop_preload);
+	registerProperty(prop_preload_budget);
+	registerProperty(prop_preload_threads);
+	registerProperty(prop_natural_sort);
+	registerProperty(prop_index_cache);
+	registerProperty(prop_pacing_speed);
+	registerProperty(prop_pacing_source);
+	registerProperty(prop_pacing_fps);
+	registerProperty(prop_pacing_timestamp_scale);
+	registerProperty(prop_pacing_timestamps_file);
+	registerProperty(prop_pacing_tolerance);
+	registerProperty(prop_pacing_drop_late);
 
 	CLOG(LTRACE) << "Constructed";
 }
 
 Sequence::~Sequence() {
+	for (size_t k = 0; k < out_matched.size(); ++k)
+		delete out_matched[k];
+
 	CLOG(LTRACE) << "Destroyed";
 }
 
@@ -40,7 +86,17 @@ Sequence::~Sequence() {
 void Sequence::prepareInterface() {
 	// Register streams.
 	registerStream("out_img", &out_img);
+	registerStream("out_timestamp", &out_timestamp);
 	registerStream("out_end_of_sequence_trigger", &out_end_of_sequence_trigger);
+
+	// Streams for the images from the other directories.
+	size_t count = directories().size();
+	for (size_t k = 1; k < count; ++k) {
+		out_matched.push_back(new Base::DataStreamOut<cv::Mat>);
+		registerStream("out_img" + boost::lexical_cast<std::string>(k), out_matched.back());
+	}
+	if (count > 1)
+		registerStream("out_images", &out_images);
 	registerStream("in_publish_image_trigger", &in_publish_image_trigger);
 	registerStream("in_next_image_trigger", &in_next_image_trigger);
 	registerStream("in_prev_image_trigger", &in_prev_image_trigger);
@@ -86,12 +142,30 @@ bool Sequence::onInit() {
 	next_image_flag = false;
 	prev_image_flag = false;
 	reload_sequence_flag = true;
+	scan_done = false;
 
 	return true;
 }
 
 bool Sequence::onFinish() {
 	CLOG(LTRACE) << "onFinish";
+	waitScan();
+	scan_thread.reset();
+	if (prefetcher.running()) {
+		CLOG(LINFO) << "Prefetch hits: " << prefetcher.hits() << " misses: " << prefetcher.misses();
+		prefetcher.stop();
+	}
+	matched_prefetchers.clear();
+	if (prop_preload) {
+		CLOG(LINFO) << "Preload cache hits: " << cache.hits() << " misses: " << cache.misses()
+				<< " evictions: " << cache.evictions();
+	}
+	if (prop_pacing_speed > 0) {
+		CLOG(LINFO) << "Paced images: " << pacer.frames() << " late: " << pacer.late()
+				<< " dropped: " << pacer.dropped();
+	}
+	cache.clear();
+	containers.clear();
 	return true;
 }
 
@@ -116,13 +190,51 @@ void Sequence::onLoadImage() {
 
 	
 	if(reload_sequence_flag) {
+		// Scan the directory in background, old sequence is played meanwhile.
+		if (startScan())
+			reload_sequence_flag = false;
+
+		// Nothing to play yet - wait for the list of files.
+		if (files.empty())
+			waitScan();
+	}
+
+	if (scanFinished()) {
 		// Try to reload PCDSequence.
 		if (!findFiles()) {
 			CLOG(LERROR) << "There are no files matching the regular expression "
 					<< prop_pattern << " in " << prop_directory;
 		}
 		index = 0;
-		reload_sequence_flag = false;
+		previous_index = -1;
+
+		// Decode whole sequence at once.
+		cache.clear();
+		if (prop_preload) {
+			cache.setBudget((size_t)prop_preload_budget * 1024 * 1024);
+			int loaded = cache.preload(imageFiles(), prop_preload_threads);
+			CLOG(LINFO) << "Preloaded " << loaded << " of " << files.size() << " images ("
+					<< cache.bytes() / (1024 * 1024) << " MB)";
+		}
+
+		// Restart playback clock.
+		findTimestamps();
+		pacer.setSpeed(prop_pacing_speed);
+		pacer.setTolerance(prop_pacing_tolerance);
+		pacer.setDropLate(prop_pacing_drop_late);
+		pacer.resetCounters();
+
+		// Restart background loading for the new list of files.
+		matched_prefetchers.clear();
+		if (prop_prefetch_frames > 0) {
+			prefetcher.start(imageFiles(), prop_prefetch_threads);
+			for (size_t k = 0; k < matched_files.size(); ++k) {
+				matched_prefetchers.push_back(boost::shared_ptr<Prefetcher>(new Prefetcher));
+				matched_prefetchers[k]->start(matched_files[k], prop_prefetch_threads);
+			}
+		} else {
+			prefetcher.stop();
+		}
 	} else if (previous_index == -1) {
 		// Special case - start!
 			index = 0;
@@ -187,26 +299,60 @@ void Sequence::onLoadImage() {
 		if (index == previous_index) {
 			CLOG(LDEBUG) << "Returning previous image";
 			// There is no need to load the image - return stored one.
-			out_img.write(img);
+			writeImages();
 			return;
 		}//: if
 
-		CLOG(LDEBUG) << "Loading image from file";
-		// Get file extension.
-		std::string ext = files[index].substr(files[index].rfind(".")+1);
-		CLOG(LDEBUG) << "Extracted file extension " << ext;
-		// Read depth from yaml.
-		if ((ext == "xml") || (ext == "yaml") || (ext == "yml") || (ext == "gz")){
-			cv::FileStorage file(files[index], cv::FileStorage::READ);
-			file["img"] >> img;
+		if (prefetcher.running()) {
+			// Move read-ahead window, so that workers can start with the upcoming images.
+			std::vector<int> window = prefetchWindow();
+			prefetcher.schedule(window);
+			for (size_t k = 0; k < matched_prefetchers.size(); ++k)
+				matched_prefetchers[k]->schedule(window);
+		}
+
+		// Images from the other directories are loaded in parallel with the first one.
+		std::vector<cv::Mat> matched(matched_files.size());
+		bool cached = false;
+		int count = matched.size() + 1;
+		Types::ThreadPool::instance().run(boost::bind(&Sequence::loadImages, this, _1, index, &cached, &matched),
+				count, count, count);
+
+		if (img.empty()) {
+			CLOG(LWARNING) << "Image reading failed! [" << files[index] << "]";
+			return;
 		}
-		else
-			img = cv::imread(files[index], CV_LOAD_IMAGE_ANYDEPTH | CV_LOAD_IMAGE_ANYCOLOR);
+
+		// Whole set is published, or nothing.
+		for (size_t k = 0; k < matched.size(); ++k) {
+			if (matched[k].empty()) {
+				CLOG(LWARNING) << "Image reading failed! [" << matched_files[k][index] << "]";
+				return;
+			}
+		}
+		matched_imgs.swap(matched);
+
+		// Keep it for the next loop. In loop playback the least recently used image is
+		// the one needed soonest, so nothing is evicted - cache keeps the images it holds.
+		if (prop_preload && !cached)
+			cache.put(index, img, !prop_loop);
 
 		CLOG(LINFO) <<"Image loaded properly from "<<files[index];
 		previous_index = index;
+
+		// Wait until image is due - timestamps are negated when playing backwards,
+		// so that pacer sees them increasing.
+		if (prop_pacing_speed > 0) {
+			double ts = timestamps[index];
+			if (prop_auto_prev_image && !prop_auto_next_image)
+				ts = -ts;
+			if (!pacer.wait(ts)) {
+				CLOG(LDEBUG) << "Image " << index << " late - dropped";
+				return;
+			}
+		}
 		// Write image to the output port.
-		out_img.write(img);
+		writeImages();
 
 	} catch (...) {
 		CLOG(LWARNING) << "Image reading failed! [" << files[index] << "]";
@@ -255,17 +401,279 @@ bool Sequence::onStop() {
 	return true;
 }
 
+bool Sequence::loadFrame(int index, cv::Mat & image) {
+	if (frames[index] >= 0) {
+		// Frame from container - no decoding, just a view on the mapped file.
+		image = containers[files[index]]->frame(frames[index]);
+		return true;
+	}
+
+	if (prop_preload && cache.get(index, image)) {
+		CLOG(LDEBUG) << "Image taken from preload cache";
+		return true;
+	}
+
+	if (prefetcher.running() && prefetcher.fetch(index, image)) {
+		CLOG(LDEBUG) << "Image taken from prefetch buffer (hits: " << prefetcher.hits()
+				<< ", misses: " << prefetcher.misses() << ")";
+	} else {
+		CLOG(LDEBUG) << "Loading image from file";
+		image = loadImage(files[index]);
+	}
+	return false;
+}
+
+void Sequence::loadImages(const cv::Range & items, int index, bool * cached, std::vector<cv::Mat> * matched) {
+	for (int k = items.start; k < items.end; ++k) {
+		if (k > 0) {
+			loadMatched(k - 1, index, &(*matched)[k - 1]);
+			continue;
+		}
+		try {
+			*cached = loadFrame(index, img);
+		} catch (...) {
+			img = cv::Mat();
+		}
+	}
+}
+
+void Sequence::loadMatched(size_t k, int index, cv::Mat * image) {
+	try {
+		if (k < matched_prefetchers.size() && matched_prefetchers[k]->fetch(index, *image))
+			return;
+		*image = loadImage(matched_files[k][index]);
+	} catch (...) {
+		*image = cv::Mat();
+	}
+}
+
+void Sequence::writeImages() {
+	boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+	boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+	out_timestamp.write((now - epoch).total_microseconds() / 1e6);
+
+	out_img.write(img);
+
+	if (out_matched.empty())
+		return;
+
+	std::vector<cv::Mat> images;
+	images.push_back(img);
+	for (size_t k = 0; k < matched_imgs.size() && k < out_matched.size(); ++k) {
+		out_matched[k]->write(matched_imgs[k]);
+		images.push_back(matched_imgs[k]);
+	}
+	out_images.write(images);
+}
+
+std::vector<int> Sequence::prefetchWindow() const {
+	std::vector<int> window;
+	int size = files.size();
+	window.push_back(index);
+
+	// Direction of playback - when both flags are set the index doesn't move,
+	// manually triggered sequences are assumed to go forward.
+	int step = (prop_auto_next_image ? 1 : 0) - (prop_auto_prev_image ? 1 : 0);
+	if (step == 0) {
+		if (prop_auto_next_image)
+			return window;
+		step = 1;
+	}
+
+	int idx = index;
+	for (int i = 0; i < prop_prefetch_frames && i < size - 1; ++i) {
+		idx += step;
+		if (idx < 0 || idx >= size) {
+			if (!prop_loop)
+				break;
+			idx = (idx + size) % size;
+		}
+		window.push_back(idx);
+	}
+
+	return window;
+}
+
+void Sequence::findTimestamps() {
+	double fps = prop_pacing_fps > 0 ? (double)prop_pacing_fps : 25.0;
+
+	timestamps.resize(files.size());
+	for (size_t i = 0; i < files.size(); ++i)
+		timestamps[i] = i / fps;
+
+	std::string source = prop_pacing_source;
+	if (source == "filename") {
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (frames[i] >= 0)
+				continue;
+			if (!timestampFromName(files[i], prop_pacing_timestamp_scale, timestamps[i]))
+				CLOG(LWARNING) << "No timestamp in file name " << files[i];
+		}
+	} else if (source == "file") {
+		std::ifstream in(std::string(prop_pacing_timestamps_file).c_str());
+		if (!in) {
+			CLOG(LWARNING) << "Couldn't open timestamps file " << prop_pacing_timestamps_file;
+			return;
+		}
+		size_t i = 0;
+		double ts;
+		while (i < timestamps.size() && (in >> ts))
+			timestamps[i++] = ts;
+		if (i < timestamps.size())
+			CLOG(LWARNING) << "Timestamps file contains only " << i << " of " << timestamps.size() << " entries";
+	} else if (source != "fps") {
+		CLOG(LWARNING) << "Unknown timestamps source " << source << ", using fps";
+	}
+}
+
+std::vector<std::string> Sequence::imageFiles() const {
+	std::vector<std::string> names = files;
+	for (size_t i = 0; i < names.size(); ++i)
+		if (frames[i] >= 0)
+			names[i].clear();
+	return names;
+}
+
+std::vector<std::string> Sequence::directories() const {
+	std::vector<std::string> dirs;
+	std::string d = prop_directory;
+	boost::split(dirs, d, boost::is_any_of(","));
+	for (size_t i = 0; i < dirs.size(); ++i)
+		boost::trim(dirs[i]);
+	return dirs;
+}
+
+bool Sequence::startScan() {
+	if (scan_thread)
+		return false;
+
+	// Only directories with registered output streams are used.
+	std::vector<std::string> dirs = directories();
+	if (dirs.size() > out_matched.size() + 1) {
+		CLOG(LWARNING) << "Directories added after initialization are ignored";
+		dirs.resize(out_matched.size() + 1);
+	}
+
+	scan_done = false;
+	scan_thread.reset(new boost::thread(boost::bind(&Sequence::scanFiles, this,
+			dirs, std::string(prop_pattern), (bool)prop_index_cache,
+			(bool)prop_sort, (bool)prop_natural_sort, std::string(prop_match) == "stem", (bool)prop_sharded)));
+	return true;
+}
+
+void Sequence::waitScan() {
+	if (scan_thread && scan_thread->joinable())
+		scan_thread->join();
+}
+
+bool Sequence::scanFinished() {
+	if (!scan_thread)
+		return false;
+
+	{
+		boost::mutex::scoped_lock lock(scan_mutex);
+		if (!scan_done)
+			return false;
+	}
+
+	waitScan();
+	scan_thread.reset();
+	return true;
+}
+
+void Sequence::scanFiles(std::vector<std::string> directories, std::string pattern, bool use_cache, bool sort, bool natural, bool stem, bool sharded) {
+	std::vector<std::vector<std::string> > found(directories.size());
+	for (size_t k = 0; k < directories.size(); ++k) {
+		try {
+			if (sharded)
+				found[k] = searchShardedFiles(directories[k], pattern, use_cache);
+			else
+				found[k] = searchFiles(directories[k], pattern, use_cache);
+
+			if (natural)
+				std::sort(found[k].begin(), found[k].end(), naturalLess);
+			else if (sort)
+				std::sort(found[k].begin(), found[k].end());
+		} catch (...) {
+			LOG(LERROR) << "Searching for files in " << directories[k] << " failed";
+		}
+	}
+
+	if (stem) {
+		size_t removed = matchStems(found);
+		if (removed > 0)
+			LOG(LWARNING) << removed << " files have no counterparts in all directories - skipped";
+	}
+
+	boost::mutex::scoped_lock lock(scan_mutex);
+	scanned_files.swap(found);
+	scan_done = true;
+}
+
 bool Sequence::findFiles() {
+	std::vector<std::string> found;
+	matched_files.clear();
+	matched_imgs.clear();
+	{
+		boost::mutex::scoped_lock lock(scan_mutex);
+		if (!scanned_files.empty()) {
+			found.swap(scanned_files[0]);
+			matched_files.assign(scanned_files.begin() + 1, scanned_files.end());
+		}
+		scanned_files.clear();
+	}
+
+	// Images from old containers, still being processed, keep their mappings themselves.
+	containers.clear();
+
 	files.clear();
+	frames.clear();
+
+	BOOST_FOREACH(std::string fname, found) {
+		std::string ext = fname.substr(fname.rfind(".")+1);
+		if (ext != Types::FrameContainer::Extension) {
+			CLOG(LDEBUG) << fname;
+			files.push_back(fname);
+			frames.push_back(-1);
+			continue;
+		}
 
-	files = Utils::searchFiles(prop_directory, prop_pattern);
+		// Expand container into its frames.
+		boost::shared_ptr<Types::FrameContainerReader> reader(new Types::FrameContainerReader);
+		if (!reader->open(fname)) {
+			CLOG(LWARNING) << "Couldn't open frame container " << fname;
+			continue;
+		}
+		CLOG(LDEBUG) << fname << " (" << reader->size() << " frames)";
+		containers[fname] = reader;
+		for (size_t i = 0; i < reader->size(); ++i) {
+			files.push_back(fname);
+			frames.push_back(i);
+		}
+	}
+
+	// Frames with the same index are published together - drop the ones without counterparts.
+	if (!matched_files.empty()) {
+		size_t count = files.size();
+		for (size_t k = 0; k < matched_files.size(); ++k) {
+			for (size_t i = 0; i < matched_files[k].size(); ++i) {
+				if (matched_files[k][i].substr(matched_files[k][i].rfind(".")+1) == Types::FrameContainer::Extension) {
+					CLOG(LWARNING) << "Frame containers are supported only in the first directory";
+					break;
+				}
+			}
+			count = std::min(count, matched_files[k].size());
+		}
+		if (count < files.size())
+			CLOG(LWARNING) << "Sequences differ in length - " << files.size() - count << " images skipped";
 
-	if (prop_sort)
-		std::sort(files.begin(), files.end());
+		files.resize(count);
+		frames.resize(count);
+		for (size_t k = 0; k < matched_files.size(); ++k)
+			matched_files[k].resize(count);
+	}
 
-	CLOG(LINFO) << "Sequence loaded.";
-	BOOST_FOREACH(std::string fname, files)
-		CLOG(LINFO) << fname;
+	CLOG(LINFO) << files.size() << " images in sequence";
 
 	return !files.empty();
 }
@@ -12,8 +12,18 @@
 #include "DataStream.hpp"
 #include "Property.hpp"
 
+#include "Prefetcher.hpp"
+#include "FrameCache.hpp"
+#include "Types/FrameContainer.hpp"
+#include "Types/PlaybackPacer.hpp"
+
 #include <vector>
 #include <string>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <opencv2/core/core.hpp>
 
@@ -27,11 +37,26 @@
  * available, based on image filename pattern (regular expression) and directory,
  * in which files will be searched.
  *
+ * Several directories (separated by commas) can be given - then frames with the same
+ * index (or file name without extension) are loaded in parallel and published
+ * together, both on separate streams and as one set on \c out_images. Preloading applies
+ * only to the first directory, frame containers are expanded only in the first directory.
+ *
+ * Matched files with \c cvraw extension are treated as \ref Types::FrameContainerReader "frame containers"
+ * (written e.g. by ImageWriter) - all of their frames are added to the sequence and
+ * returned directly from the memory-mapped file, without decoding.
+ *
  *
  * \par Data streams:
  *
  * \streamout{out_img,cv::Mat}
- * Output image
+ * Output image (from the first directory)
+ * \streamout{out_timestamp,double}
+ * Time of publishing the image (in seconds since epoch), written before the images
+ * \streamout{out_imgN,cv::Mat}
+ * Output image from the N-th directory (counting from 0), registered for N > 0
+ * \streamout{out_images,std::vector<cv::Mat>}
+ * Images from all directories, registered if there is more than one directory
  *
  *
  * \par Events:
@@ -51,13 +76,49 @@
  * \par Properties:
  *
  * \prop{directory,string,"."}
- * Directory, where fils will be searched
+ * Directory, where fils will be searched, or comma separated list of directories
+ * \prop{sequence.sharded,bool,false}
+ * If set, files are searched also in subdirectories of the directory (e.g. shards written by ImageWriter)
+ * \prop{sequence.match,string,"index"}
+ * Matching of frames from several directories: "index" (position in sorted list) or "stem" (file name without extension)
  * \prop{pattern,string,".*\.jpg"}
  * Regex pattern used for searching files
  * \prop{sort,bool,true}
  * If set, then found siles will be sorted in ascending order
- * \prop{prefetch,bool,false}
- * If set, all files will be loaded beforehand, otherwise images are loaded just before they are needed.
+ * \prop{mode.natural_sort,bool,false}
+ * If set, found files are sorted in natural order (numbers inside names compared by value), overrides sort
+ * \prop{sequence.index_cache,bool,false}
+ * If set, list of found files is stored in the user's cache directory ($XDG_CACHE_HOME or ~/.cache, in discode/sequence_index)
+ * and reused until the sequence directory is modified
+ * \prop{prefetch.frames,int,0}
+ * Number of images loaded in background ahead of the current one (in the direction of playback, wrapping in loop mode).
+ * If set to 0, images are loaded just before they are needed.
+ * \prop{prefetch.threads,int,1}
+ * Number of threads loading images in background
+ * \prop{mode.preload,bool,false}
+ * If set, whole sequence is decoded (in parallel) when it is loaded and kept in memory,
+ * images not fitting into the budget are cached on first use (least recently used are evicted, except in loop mode,
+ * where the cached images stay and the rest is loaded every time).
+ * \prop{preload.budget,int,1024}
+ * Memory budget of preloaded images, in megabytes
+ * \prop{preload.threads,int,0}
+ * Number of threads decoding the sequence, 0 means one thread per core
+ * \prop{pacing.speed,double,0}
+ * Real-time replay - images are published according to their timestamps, with given speed multiplier.
+ * If set to 0, images are published as fast as the executor runs.
+ * \prop{pacing.source,string,"fps"}
+ * Source of timestamps: "fps" (constant frame rate), "filename" (time or number encoded in file name)
+ * or "file" (text file with one timestamp in seconds per line, in order of the sequence)
+ * \prop{pacing.fps,double,25}
+ * Frame rate used in "fps" mode (and for names without timestamps)
+ * \prop{pacing.timestamp_scale,double,1}
+ * Number of seconds per unit of number found in file name (e.g. 0.001 for milliseconds)
+ * \prop{pacing.timestamps_file,string,""}
+ * Name of the file with timestamps
+ * \prop{pacing.tolerance,double,0.05}
+ * Delay (in seconds) after which image is treated as late
+ * \prop{pacing.drop_late,bool,false}
+ * If set, late images are not published
  * \prop{triggered,bool,false}
  * If set, new frames will be produced only after onTrigger event
  *
@@ -126,6 +187,15 @@ protected:
 	/// Output data stream
 	Base::DataStreamOut<cv::Mat> out_img;
 
+	/// Output data stream - time of publishing the image.
+	Base::DataStreamOut<double> out_timestamp;
+
+	/// Output data streams - images from the other directories.
+	std::vector<Base::DataStreamOut<cv::Mat> *> out_matched;
+
+	/// Output data stream - images from all directories.
+	Base::DataStreamOut<std::vector<cv::Mat> > out_images;
+
 	/// Output event - sequence ended.
 	Base::DataStreamOut<Base::UnitType> out_end_of_sequence_trigger;
 
@@ -171,20 +241,101 @@ protected:
 
 private:
 	/**
-	 * Fill list of files according to pattern
+	 * Fill list of files with the results of the last directory scan.
 	 *
 	 * \return true, if there is at least one file found, false otherwise
 	 */
 	bool findFiles();
 
+	/**
+	 * Starts scanning the directory in background thread.
+	 *
+	 * \return false if the previous scan is still in progress
+	 */
+	bool startScan();
+
+	/// Waits for the background scan to finish.
+	void waitScan();
+
+	/// Returns true (once) when the scan started by startScan is finished.
+	bool scanFinished();
+
+	/// Background scan thread body.
+	void scanFiles(std::vector<std::string> directories, std::string pattern, bool use_cache, bool sort, bool natural, bool stem, bool sharded);
+
+	/// Returns list of directories given in sequence.directory.
+	std::vector<std::string> directories() const;
+
+	/**
+	 * Loads image of the sequence from the first directory.
+	 *
+	 * \return true if image was taken from the preload cache or the frame container
+	 */
+	bool loadFrame(int index, cv::Mat & image);
+
+	/// Loads image matched with the given one from k-th of the other directories.
+	void loadMatched(size_t k, int index, cv::Mat * image);
+
+	/**
+	 * Loads given items of the image set - 0 is the image of the first directory
+	 * (stored in img), k is the image matched with it from the k-th directory.
+	 */
+	void loadImages(const cv::Range & items, int index, bool * cached, std::vector<cv::Mat> * matched);
+
+	/// Writes current image (and images matched with it) to the output streams.
+	void writeImages();
+
+	/// Thread scanning the directory.
+	boost::shared_ptr<boost::thread> scan_thread;
+
+	/// Protects results of the scan.
+	boost::mutex scan_mutex;
+
+	/// Set by scan thread when it's finished.
+	bool scan_done;
+
+	/// Files found by scan thread, for each directory.
+	std::vector<std::vector<std::string> > scanned_files;
+
+	/**
+	 * Compute indices of images, that will be needed next (starting from the current one).
+	 */
+	std::vector<int> prefetchWindow() const;
+
+	/**
+	 * Fill list of timestamps of images, according to pacing.source.
+	 */
+	void findTimestamps();
+
+	/**
+	 * Returns list of files that can be decoded independently - entries
+	 * referring to frame containers are left empty.
+	 */
+	std::vector<std::string> imageFiles() const;
+
 	/// List of file names in sequence.
 	std::vector<std::string> files;
 
+	/// Index of frame inside the container file, -1 for ordinary image files.
+	std::vector<int> frames;
+
+	/// Opened frame containers, by file name.
+	std::map<std::string, boost::shared_ptr<Types::FrameContainerReader> > containers;
+
 	//std::vector<cv::Mat> images;
 
 	/// Current image.
 	cv::Mat img;
 
+	/// Files of the other directories, matched with the files of the first one.
+	std::vector<std::vector<std::string> > matched_files;
+
+	/// Images matched with the current one.
+	std::vector<cv::Mat> matched_imgs;
+
+	/// Background loaders of images from the other directories.
+	std::vector<boost::shared_ptr<Prefetcher> > matched_prefetchers;
+
 	/// Index of current image.
 	int index;
 
@@ -211,6 +362,12 @@ private:
 	/// Files pattern (regular expression).
 	Base::Property<std::string> prop_pattern;
 
+	/// Matching of frames from several directories.
+	Base::Property<std::string> prop_match;
+
+	/// Search for files in subdirectories.
+	Base::Property<bool> prop_sharded;
+
 	/// Publishing mode: auto vs triggered.
 	Base::Property<bool> prop_auto_publish_image;
 
@@ -226,8 +383,59 @@ private:
 	/// Sort image sequence by their names.
 	Base::Property<bool> prop_sort;
 
-	/// TODO: loads whole sequence at start.
-//	Base::Property<bool> prop_read_on_init;
+	/// Sort image sequence in natural order.
+	Base::Property<bool> prop_natural_sort;
+
+	/// Keep list of files in the cache directory.
+	Base::Property<bool> prop_index_cache;
+
+	/// Number of images loaded in background ahead of the current one.
+	Base::Property<int> prop_prefetch_frames;
+
+	/// Number of threads loading images in background.
+	Base::Property<int> prop_prefetch_threads;
+
+	/// Background loader of images.
+	Prefetcher prefetcher;
+
+	/// Loads whole sequence at start.
+	Base::Property<bool> prop_preload;
+
+	/// Memory budget of preloaded images (MB).
+	Base::Property<int> prop_preload_budget;
+
+	/// Number of threads decoding the sequence.
+	Base::Property<int> prop_preload_threads;
+
+	/// Preloaded images.
+	FrameCache cache;
+
+	/// Playback speed multiplier, 0 - no pacing.
+	Base::Property<double> prop_pacing_speed;
+
+	/// Source of timestamps.
+	Base::Property<std::string> prop_pacing_source;
+
+	/// Frame rate used if timestamps are not available.
+	Base::Property<double> prop_pacing_fps;
+
+	/// Scale of timestamps encoded in file names.
+	Base::Property<double> prop_pacing_timestamp_scale;
+
+	/// File with timestamps.
+	Base::Property<std::string> prop_pacing_timestamps_file;
+
+	/// Delay after which image is treated as late.
+	Base::Property<double> prop_pacing_tolerance;
+
+	/// Drop late images.
+	Base::Property<bool> prop_pacing_drop_late;
+
+	/// Timestamps of images (in seconds).
+	std::vector<double> timestamps;
+
+	/// Delays publishing of images according to timestamps.
+	Types::PlaybackPacer pacer;
 
 };
 
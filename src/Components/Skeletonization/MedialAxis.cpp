@@ -0,0 +1,147 @@
+/*!
+ * \file MedialAxis.cpp
+ * \brief Medial axis from the distance transform - methods definition.
+ */
+
+#include "MedialAxis.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace Processors {
+namespace Skeletonization {
+
+namespace {
+
+/// Buckets per pixel of distance.
+const float Resolution = 16;
+
+/// Offsets of the neighbours (N, NE, E, SE, S, SW, W, NW) in the image of given width.
+inline void offsets(int w, int * o) {
+	o[0] = -w;
+	o[1] = -w + 1;
+	o[2] = 1;
+	o[3] = w + 1;
+	o[4] = w;
+	o[5] = w - 1;
+	o[6] = -1;
+	o[7] = -w - 1;
+}
+
+} //: namespace
+
+MedialAxis::MedialAxis() {
+	// Neighbours around the pixel, from N clockwise, are 8-connected with the next and
+	// previous ones, edge neighbours (N, E, S, W) also with the next but one.
+	for (int code = 0; code < 256; ++code) {
+		int label[8];
+		int count = 0, components = 0;
+		for (int k = 0; k < 8; ++k) {
+			label[k] = (code >> k) & 1 ? k : -1;
+			count += (code >> k) & 1;
+		}
+
+		// Merge labels until nothing changes (at most few passes).
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (int k = 0; k < 8; ++k) {
+				if (label[k] < 0)
+					continue;
+				int steps = (k % 2 == 0) ? 2 : 1;
+				for (int s = 1; s <= steps; ++s) {
+					int n = (k + s) % 8;
+					if (label[n] >= 0 && label[n] != label[k]) {
+						label[n] = label[k] = std::min(label[n], label[k]);
+						changed = true;
+					}
+				}
+			}
+		}
+		for (int k = 0; k < 8; ++k)
+			components += (label[k] == k);
+
+		// End of the line and pixels joining separate neighbours are kept, as well as
+		// interior pixels (all edge neighbours set) - removing them would make a hole.
+		bool interior = (code & 0x55) == 0x55;
+		m_keep[code] = count < 2 || components != 1 || interior;
+	}
+}
+
+void MedialAxis::compute(const cv::Mat & im, cv::Mat & axis) {
+	CV_Assert(im.type() == CV_8UC1);
+
+	// Objects are thinned in the copy with background frame, so neighbours always exist
+	// and pixels outside of the image are background for the distance transform too.
+	const int w = im.cols + 2;
+	m_padded.create(im.rows + 2, w, CV_8UC1);
+	m_padded.setTo(cv::Scalar(0));
+	int o[8];
+	offsets(w, o);
+
+	for (int y = 0; y < im.rows; ++y) {
+		const uchar * src = im.ptr<uchar>(y);
+		uchar * dst = m_padded.ptr<uchar>(y + 1) + 1;
+		for (int x = 0; x < im.cols; ++x)
+			dst[x] = src[x] ? 1 : 0;
+	}
+
+	// Exact euclidean distance (linear time).
+	cv::distanceTransform(m_padded, m_padded_distance, CV_DIST_L2, CV_DIST_MASK_PRECISE);
+	m_distance = m_padded_distance(cv::Rect(1, 1, im.cols, im.rows));
+
+	float max_distance = 0;
+	for (int y = 0; y < im.rows; ++y) {
+		const float * d = m_distance.ptr<float>(y);
+		for (int x = 0; x < im.cols; ++x)
+			if (d[x] > max_distance)
+				max_distance = d[x];
+	}
+
+	// Bucket of the pixel - distance, then number of background neighbours (pixels
+	// in corners go later).
+	int buckets = ((int)(max_distance * Resolution) + 1) * 9;
+	m_counts.assign(buckets + 1, 0);
+	m_keys.resize(m_padded.total());
+	const uchar * p = m_padded.data;
+	for (int y = 0; y < im.rows; ++y) {
+		const float * d = m_distance.ptr<float>(y);
+		for (int x = 0; x < im.cols; ++x) {
+			int i = (y + 1) * w + x + 1;
+			if (!p[i])
+				continue;
+			int background = 0;
+			for (int k = 0; k < 8; ++k)
+				background += !p[i + o[k]];
+			int key = (int)(d[x] * Resolution) * 9 + background;
+			m_keys[i] = key;
+			++m_counts[key + 1];
+		}
+	}
+	for (int b = 0; b < buckets; ++b)
+		m_counts[b + 1] += m_counts[b];
+
+	m_order.resize(m_counts[buckets]);
+	for (int y = 0; y < im.rows; ++y) {
+		for (int x = 0; x < im.cols; ++x) {
+			int i = (y + 1) * w + x + 1;
+			if (p[i])
+				m_order[m_counts[m_keys[i]]++] = i;
+		}
+	}
+
+	// Single pass over pixels, in the order of distance.
+	uchar * q = m_padded.data;
+	for (size_t n = 0; n < m_order.size(); ++n) {
+		int i = m_order[n];
+		int code = 0;
+		for (int k = 0; k < 8; ++k)
+			code |= q[i + o[k]] << k;
+		q[i] = m_keep[code];
+	}
+
+	m_padded(cv::Rect(1, 1, im.cols, im.rows)).copyTo(axis);
+}
+
+}//: namespace Skeletonization
+}//: namespace Processors
@@ -0,0 +1,71 @@
+/*!
+ * \file MedialAxis.hpp
+ * \brief Medial axis from the distance transform - class declaration.
+ */
+
+#ifndef SKELETONIZATION_MEDIALAXIS_HPP_
+#define SKELETONIZATION_MEDIALAXIS_HPP_
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace Processors {
+namespace Skeletonization {
+
+/*!
+ * \class MedialAxis
+ * \brief Medial axis of objects of binary image, with radius of the inscribed disks.
+ *
+ * Euclidean distance to the background is computed in linear time. Object pixels
+ * are then visited once, ordered by the distance (with bucket sort, so the ordering
+ * is linear too), pixels closest to the background first. Each pixel is removed,
+ * unless it is an end of the line, an interior pixel (all four edge neighbours
+ * set) or its removal would split its neighbourhood. Only such simple points are
+ * removed, so neither objects nor holes are split or created, and the remaining
+ * pixels lie on the ridges of the distance transform.
+ */
+class MedialAxis {
+public:
+	MedialAxis();
+
+	/*!
+	 * Computes the axis.
+	 *
+	 * \param im 8-bit, single channel image, object pixels are non-zero
+	 * \param axis 8-bit image, 1 for axis pixels and 0 for others
+	 */
+	void compute(const cv::Mat & im, cv::Mat & axis);
+
+	/// Distance transform of the last image (32-bit float).
+	const cv::Mat & distance() const {
+		return m_distance;
+	}
+
+private:
+	/// Pixels kept, for every neighbourhood.
+	uchar m_keep[256];
+
+	/// Distance transform of the padded image.
+	cv::Mat m_padded_distance;
+
+	/// Part of the distance transform covering the image.
+	cv::Mat m_distance;
+
+	/// Image with one pixel wide frame of background.
+	cv::Mat m_padded;
+
+	/// Beginnings of the buckets in the order.
+	std::vector<int> m_counts;
+
+	/// Indices of pixels (in padded image) in order of processing.
+	std::vector<int> m_order;
+
+	/// Buckets of pixels (of padded image).
+	std::vector<int> m_keys;
+};
+
+}//: namespace Skeletonization
+}//: namespace Processors
+
+#endif /* SKELETONIZATION_MEDIALAXIS_HPP_ */
@@ -9,6 +9,7 @@
 
 #include "Skeletonization.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
 
 #include <boost/bind.hpp>
 
@@ -16,8 +17,16 @@ namespace Processors {
 namespace Skeletonization {
 
 Skeletonization::Skeletonization(const std::string & name) :
-		Base::Component(name)  {
-
+		Base::Component(name),
+		mode("mode", std::string("thinning")),
+		algorithm("algorithm", std::string("zhang_suen")),
+		threads("threads", 1) {
+	mode.setToolTip("Skeletonization method: thinning, medial_axis");
+	registerProperty(mode);
+	algorithm.setToolTip("Thinning algorithm: zhang_suen, guo_hall");
+	registerProperty(algorithm);
+	threads.setToolTip("Number of threads (0 - all cores)");
+	registerProperty(threads);
 }
 
 Skeletonization::~Skeletonization() {
@@ -29,6 +38,7 @@ void Skeletonization::prepareInterface() {
 
 	registerStream("in_img", &in_img);
 	registerStream("out_img", &out_img);
+	registerStream("out_radius", &out_radius);
 
 	// Add default dependency of the onNewImage.
 	addDependency("onNewImage", &in_img);
@@ -52,331 +62,33 @@ bool Skeletonization::onStart() {
 }
 
 
-#define NORTH 1
-#define SOUTH 3
-
-// 1-neighbors of pixel.
-int nays8(cv::Mat im, int r, int c) {
-	cv::Scalar pixel;
-	int blue, k = 0, i, j;
-
-  for (i = r-1; i <= r+1; i++)
-		for (j = c-1; j <= c+1; j++)
-			if (i != r || c != j) {
-				pixel = im.at<uchar>(j, i);
-				blue = pixel.val[0];
-				if (blue >= 1)
-					k++;
-			}
-
-	return k;
-}
-
-int connectivity(cv::Mat im, int r, int c) {
-	int N = 0, b1, b2;
-	cv::Scalar pixel;
-
-	pixel = im.at<uchar>(r, c+1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r-1, c+1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r-1, c+1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r-1, c);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r-1, c);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r-1, c-1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r-1, c-1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r, c-1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r, c-1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r+1, c-1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r+1, c-1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r+1, c);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r+1, c);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r+1, c+1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	pixel = im.at<uchar>(r+1, c+1);
-	b1 = pixel.val[0];
-	pixel = im.at<uchar>(r, c+1);
-	b2 = pixel.val[0];
-	if (b1 >= 1 && b2 == 0)
-		N++;
-
-	return N;
-}
-
-void deleteCB(cv::Mat im, cv::Mat tmp) {
-	int w, h, blue, i, j;
-	cv::Scalar pixel;
-
-	w = im.cols;
-	h = im.rows;
-
-	for (i = 1; i < h-1; i++)
-		for (int j = 1; j < w-1; j++) {
-			pixel = tmp.at<uchar>(i, j);
-			blue = pixel.val[0];
-			if (blue == 1) {
-				//pixel.val[0] = 0;
-				//cvSet2D(im, i, j, pixel);
-				//cvSet2D(tmp, i, j, pixel);
-				im.at<uchar>(i, j) = 0;
-				tmp.at<uchar>(i, j) = 0;
-			}
-		}
-}
-
-void stair(cv::Mat im, cv::Mat tmp, int dir) {
-	int i, j, b1, b2, b3, b4, b5, b6, b7, b8, b9, w, h;
-	cv::Scalar pixel;
-	int N, S, E, W, NE, NW, SE, SW, C;
-
-	w = im.cols;
-	h = im.rows;
-
-	if (dir == NORTH)
-		for (i = 1; i < h-1; i++)
-			for (j = 1; j < w-1; j++) {
-				pixel = im.at<uchar>(i-1, j-1);
-				b1 = pixel.val[0];
-				pixel = im.at<uchar>(i-1, j);
-				b2 = pixel.val[0];
-				pixel = im.at<uchar>(i-1, j+1);
-				b3 = pixel.val[0];
-				pixel = im.at<uchar>(i, j-1);
-				b4 = pixel.val[0];
-				pixel = im.at<uchar>(i, j);
-				b5 = pixel.val[0];
-				pixel = im.at<uchar>(i, j+1);
-				b6 = pixel.val[0];
-				pixel = im.at<uchar>(i+1, j-1);
-				b7 = pixel.val[0];
-				pixel = im.at<uchar>(i+1, j);
-				b8 = pixel.val[0];
-				pixel = im.at<uchar>(i+1, j+1);
-				b9 = pixel.val[0];
-				if (b1 == 1)
-					NW = 1;
-				else
-					NW = 0;
-				if (b2 == 1)
-					N = 1;
-				else
-					N = 0;
-				if (b3 == 1)
-					NE = 1;
-				else
-					NE = 0;
-				if (b4 == 1)
-					W = 1;
-				else
-					W = 0;
-				if (b5 == 1)
-					C = 1;
-				else
-					C = 0;
-				if (b6 == 1)
-					E = 1;
-				else
-					E = 0;
-				if (b7 == 1)
-					SW = 1;
-				else
-					SW = 0;
-				if (b8 == 1)
-					S = 1;
-				else
-					S = 0;
-				if (b9 == 1)
-					SE = 1;
-				else
-					SE = 0;
-
-				if (dir == NORTH) {
-					if (C && !(N && ((E && !NE && !SW && (!W || !S)) ||
-						 (W && !NW && !SE && (!E || !S))))) {
-						//pixel.val[0] = 0;
-						//cvSet2D(tmp, i, j, pixel);
-						tmp.at<uchar>(i, j) = 0;
-					} else {
-						//pixel.val[0] = 1;
-						//cvSet2D(tmp, i, j, pixel);
-						tmp.at<uchar>(i, j) = 1;
-					}
-				} else if (dir == SOUTH) {
-					if (C && !(S && ((E && !SE && !NW && (!W || !N)) ||
-						 (W && !SW && !NE && (!E || !N))))) {
-						//pixel.val[0] = 0;
-						//cvSet2D(tmp, i, j, pixel);
-						tmp.at<uchar>(i, j) = 0;
-					} else {
-						//pixel.val[0] = 1;
-						//cvSet2D(tmp, i, j, pixel);
-						tmp.at<uchar>(i, j) = 1;
-					}
-				}
-			}
-}
-
-
-// Zhang-Suen algorithm.
-void skeletonize(cv::Mat im) {
-	int janelaAH[][2] = {
-		{1, 0}, {0, -1}, {-1, 0}, {0, 1}
-	};
-	int janelaH[][2] = {
-		{0, -1}, {1, 0}, {0, 1}, {-1, 0}
-	};
-	int aBlue[6];
-	int w, h, i, v, j, k, blue, lin, col, iJanela, again = 1;
-	cv::Scalar pixel, pixOut;
-
-	w = im.cols;
-	h = im.rows;
-
-	//cv::Mat tmp;
-	//tmp = cvCreateImage(cvGetSize(im), IPL_DEPTH_8U, 1);
-	cv::Mat tmp(im.size(), CV_8UC1, cv::Scalar(0));
-
-  for (i = 0; i < h; i++) {
-		for (j = 0; j < w; j++) {
-			pixel = im.at<uchar>(i, j);
-			blue = pixel.val[0];
-			if (blue > 0)
-				pixel.val[0] = 0;
-			else
-				pixel.val[0] = 1;
-			//cvSet2D(im, i, j, pixel);
-			im.at<uchar>(i, j) = pixel.val[0];
-			pixOut.val[0] = 0;
-			//cvSet2D(tmp, i, j, pixOut);
-			tmp.at<uchar>(i, j) = pixOut.val[0];
-		}
-	}
-
-	while (again) {
-		again = 0;
-  //for (int tmpi = 0; tmpi < 5; ++tmpi) {
-  	for (i = 1; i < h-1; i++)
-			for (j = 1; j < w-1; j++) {
-				pixel = im.at<uchar>(i, j);
-				blue = pixel.val[0];
-				if (blue != 1)
-					continue;
-				k = nays8(im, i, j);
-				iJanela = 0;
-				if ((k >= 2 && k <= 6) && connectivity(im, i, j) == 1) {
-					for (v = 0; v < 6; v++) {
-						col = j + janelaAH[iJanela][0];
-						lin = i + janelaAH[iJanela][1];
-						pixel = im.at<uchar>(lin, col);
-						aBlue[v] = pixel.val[0];
-						iJanela++;
-						if (v == 2)
-							iJanela = 1;
-					}
-					if (aBlue[0]*aBlue[1]*aBlue[2] == 0 &&
-							aBlue[3]*aBlue[4]*aBlue[5] == 0) {
-						pixOut.val[0] = 1;
-						//cvSet2D(tmp, i, j, pixOut);
-						tmp.at<uchar>(i, j) = pixOut.val[0];
-						again = 1;
-					}
-				}		// if ((k >= 2...
-			}		// for (j = 1;...
-
-			deleteCB(im, tmp);
-			if (!again)
-				break;
-
-  	for (i = 1; i < h-1; i++)
-			for (j = 1; j < w-1; j++) {
-				pixel = im.at<uchar>(i, j);
-				blue = pixel.val[0];
-				if (blue != 1)
-					continue;
-				k = nays8(im, i, j);
-				iJanela = 0;
-				if ((k >= 2 && k <= 6) && connectivity(im, i, j) == 1) {
-					for (v = 0; v < 6; v++) {
-						col = j + janelaH[iJanela][0];
-						lin = i + janelaH[iJanela][1];
-						pixel = im.at<uchar>(lin, col);
-						aBlue[v] = pixel.val[0];
-						iJanela++;
-						if (v == 2)
-							iJanela = 1;
-					}
-					if (aBlue[0]*aBlue[1]*aBlue[2] == 0 &&
-							aBlue[3]*aBlue[4]*aBlue[5] == 0) {
-						pixOut.val[0] = 1;
-						//cvSet2D(tmp, i, j, pixOut);
-						tmp.at<uchar>(i, j) = pixOut.val[0];
-						again = 1;
-					}
-				}		// if ((k >= 2...
-			}		// for (j = 1;...
-
-		deleteCB(im, tmp);
-	}		// while
-
-	stair(im, tmp, NORTH);
-	deleteCB(im, tmp);
-	stair(im, tmp, SOUTH);
-	deleteCB(im, tmp);
-
-  for (i = 1; i < h-1; i++)
-		for (j = 1; j < w-1; j++) {
-			pixel = im.at<uchar>(i, j);
-			blue = pixel.val[0];
-			if (blue > 0)
-				pixel.val[0] = 0;
-			else
-				pixel.val[0] = 255;
-			//cvSet2D(im, i, j, pixel);
-			im.at<uchar>(i, j) = pixel.val[0];
-		}
-}		// End skeletonize
-
-
-
 void Skeletonization::onNewImage()
 {
 	CLOG(LTRACE) << "Skeletonization::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
-		cv::Mat img = in_img.read().clone();
+		cv::Mat img = in_img.read();
+		probe.bytesIn(img);
+
+		// Object (black) pixels are marked with 1, background with 0.
+		cv::threshold(img, work, 0, 1, cv::THRESH_BINARY_INV);
+
+		if (std::string(mode) == "medial_axis") {
+			medial_axis.compute(work, work);
+
+			// Radius of the disk inscribed in the object, at the axis pixels.
+			cv::Mat radius(work.size(), CV_32FC1, cv::Scalar(0));
+			medial_axis.distance().copyTo(radius, work);
+			out_radius.write(radius);
+		} else {
+			thinning.thin(work, Thinning::algorithmFromString(algorithm), threads);
+			thinning.removeStairs(work, threads);
+			CLOG(LDEBUG) << name() << ": " << thinning.subiterations() << " subiterations";
+		}
 
-		skeletonize(img);
+		// Skeleton is drawn in black on white background.
+		cv::Mat out;
+		cv::threshold(work, out, 0, 255, cv::THRESH_BINARY_INV);
 
 /*		cv::threshold(img, img, 127, 255, cv::THRESH_BINARY);
 
@@ -401,7 +113,8 @@ void Skeletonization::onNewImage()
 		} while (!done);
 */
 		// Write output to stream.
-		out_img.write(img);
+		probe.bytesOut(out);
+		out_img.write(out);
 	}
 	catch (Common::DisCODeException& ex) {
 		CLOG(LERROR) << ex.what() << "\n";
@@ -16,6 +16,9 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "Thinning.hpp"
+#include "MedialAxis.hpp"
+
 namespace Processors {
 namespace Skeletonization {
 
@@ -23,7 +26,27 @@ namespace Skeletonization {
  * \class Skeletonization
  * \brief Skeletonization processor class.
  *
- * Skeletonization processor.
+ * Skeletonization processor - thins black objects of the binary image to lines of single
+ * pixel width, preserving their topology, and removes staircases of the lines.
+ *
+ * In medial_axis mode skeleton is computed from the distance transform instead, in
+ * a single pass over the image, which is much faster for large objects. Radius of
+ * the disk inscribed in the object is then written to out_radius for every pixel
+ * of the skeleton.
+ *
+ * \streamin{in_img,cv::Mat}
+ * Binary image, objects are black
+ * \streamout{out_img,cv::Mat}
+ * Skeleton, drawn in black on white background
+ * \streamout{out_radius,cv::Mat}
+ * Radius at the skeleton pixels, 0 elsewhere (CV_32FC1, medial_axis mode only)
+ *
+ * \prop{mode,string,thinning}
+ * Skeletonization method: thinning or medial_axis
+ * \prop{algorithm,string,zhang_suen}
+ * Thinning algorithm: zhang_suen or guo_hall
+ * \prop{threads,int,1}
+ * Number of threads (0 - all cores)
  */
 class Skeletonization: public Base::Component {
 public:
@@ -77,6 +100,26 @@ protected:
 	/// Output data stream - image.
 	Base::DataStreamOut <cv::Mat> out_img;
 
+	/// Output data stream - radius of the skeleton (medial axis mode).
+	Base::DataStreamOut <cv::Mat> out_radius;
+
+	/// Skeletonization method.
+	Base::Property<std::string> mode;
+
+	/// Thinning algorithm.
+	Base::Property<std::string> algorithm;
+
+	/// Number of threads.
+	Base::Property<int> threads;
+
+private:
+	Thinning thinning;
+
+	MedialAxis medial_axis;
+
+	/// Image being thinned (object pixels set to 1).
+	cv::Mat work;
+
 };
 
 } //: namespace Skeletonization
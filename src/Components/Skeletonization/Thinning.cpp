@@ -0,0 +1,196 @@
+/*!
+ * \file Thinning.cpp
+ * \brief Parallel thinning of binary images - methods definition.
+ */
+
+#include "Thinning.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "Types/ParallelFor.hpp"
+
+namespace Processors {
+namespace Skeletonization {
+
+namespace {
+
+/*!
+ * Code of the neighbourhood of pixel p, bits from the lowest: N, NE, E, SE, S, SW, W, NW
+ * (P2..P9 in Zhang-Suen notation).
+ */
+inline int neighbourhood(const uchar * im, int p, int w) {
+	const uchar * a = im + p - w;
+	const uchar * b = im + p;
+	const uchar * c = im + p + w;
+	return a[0] | (a[1] << 1) | (b[1] << 2) | (c[1] << 3) | (c[0] << 4) | (c[-1] << 5) | (b[-1] << 6) | (a[-1] << 7);
+}
+
+/// Minimum number of pixels checked by single part.
+const size_t MinPartSize = 4096;
+
+} //: namespace
+
+Thinning::Thinning() : m_subiterations(0) {
+	for (int code = 0; code < 256; ++code) {
+		int p2 = code & 1, p3 = (code >> 1) & 1, p4 = (code >> 2) & 1, p5 = (code >> 3) & 1;
+		int p6 = (code >> 4) & 1, p7 = (code >> 5) & 1, p8 = (code >> 6) & 1, p9 = (code >> 7) & 1;
+
+		// Zhang-Suen: 2..6 neighbours, single 0-1 transition around the pixel.
+		int b = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
+		int a = (!p2 && p3) + (!p3 && p4) + (!p4 && p5) + (!p5 && p6) + (!p6 && p7) + (!p7 && p8) + (!p8 && p9) + (!p9 && p2);
+		bool zs = b >= 2 && b <= 6 && a == 1;
+		m_tables[ZhangSuen1][code] = zs && !(p2 && p4 && p8) && !(p2 && p6 && p8);
+		m_tables[ZhangSuen2][code] = zs && !(p2 && p4 && p6) && !(p4 && p6 && p8);
+
+		// Guo-Hall.
+		int c = (!p2 && (p3 || p4)) + (!p4 && (p5 || p6)) + (!p6 && (p7 || p8)) + (!p8 && (p9 || p2));
+		int n1 = (p9 || p2) + (p3 || p4) + (p5 || p6) + (p7 || p8);
+		int n2 = (p2 || p3) + (p4 || p5) + (p6 || p7) + (p8 || p9);
+		int n = std::min(n1, n2);
+		bool gh = c == 1 && n >= 2 && n <= 3;
+		m_tables[GuoHall1][code] = gh && !((p6 || p7 || !p9) && p8);
+		m_tables[GuoHall2][code] = gh && !((p2 || p3 || !p5) && p4);
+
+		// Staircases.
+		m_tables[StairNorth][code] = p2 && ((p4 && !p3 && !p7 && (!p8 || !p6)) || (p8 && !p9 && !p5 && (!p4 || !p6)));
+		m_tables[StairSouth][code] = p6 && ((p4 && !p5 && !p9 && (!p8 || !p2)) || (p8 && !p7 && !p3 && (!p4 || !p2)));
+	}
+}
+
+Thinning::Algorithm Thinning::algorithmFromString(const std::string & name) {
+	if (name == "guo_hall")
+		return GuoHall;
+	return ZhangSuen;
+}
+
+void Thinning::thin(cv::Mat & im, Algorithm algorithm, int threads) {
+	CV_Assert(im.type() == CV_8UC1 && im.isContinuous());
+	m_subiterations = 0;
+	if (im.rows < 3 || im.cols < 3)
+		return;
+
+	Table tables[2] = { ZhangSuen1, ZhangSuen2 };
+	if (algorithm == GuoHall) {
+		tables[0] = GuoHall1;
+		tables[1] = GuoHall2;
+	}
+
+	std::vector<int> removed[2];
+	m_marks.assign(im.total(), 0);
+	const int w = im.cols;
+	const int offsets[8] = { -w - 1, -w, -w + 1, -1, 1, w - 1, w, w + 1 };
+
+	// Stops when two consecutive sub-iterations haven't removed anything.
+	for (int s = 0, idle = 0; idle < 2; s ^= 1, ++m_subiterations) {
+		if (m_subiterations < 2) {
+			pass(im, tables[s], threads, removed[s]);
+		} else {
+			// Candidates - interior object pixels around the removed ones.
+			m_candidates.clear();
+			for (int r = 0; r < 2; ++r) {
+				for (size_t i = 0; i < removed[r].size(); ++i) {
+					for (int k = 0; k < 8; ++k) {
+						int q = removed[r][i] + offsets[k];
+						int y = q / w, x = q - y * w;
+						if (m_marks[q] || !im.data[q] || y < 1 || y >= im.rows - 1 || x < 1 || x >= w - 1)
+							continue;
+						m_marks[q] = 1;
+						m_candidates.push_back(q);
+					}
+				}
+			}
+			for (size_t i = 0; i < m_candidates.size(); ++i)
+				m_marks[m_candidates[i]] = 0;
+
+			passCandidates(im, tables[s], threads, removed[s]);
+		}
+
+		idle = removed[s].empty() ? idle + 1 : 0;
+	}
+}
+
+void Thinning::removeStairs(cv::Mat & im, int threads) {
+	CV_Assert(im.type() == CV_8UC1 && im.isContinuous());
+	if (im.rows < 3 || im.cols < 3)
+		return;
+
+	std::vector<int> removed;
+	pass(im, StairNorth, threads, removed);
+	pass(im, StairSouth, threads, removed);
+}
+
+void Thinning::pass(cv::Mat & im, Table table, int threads, std::vector<int> & removed) {
+	int count = partsFor(im.total(), threads);
+	m_found.resize(count);
+	Types::ThreadPool::instance().run(boost::bind(&Thinning::checkRows, this, _1, boost::cref(im), table, count),
+			count, threads, count);
+	collect(im, removed);
+}
+
+void Thinning::passCandidates(cv::Mat & im, Table table, int threads, std::vector<int> & removed) {
+	int count = partsFor(m_candidates.size(), threads);
+	m_found.resize(count);
+	Types::ThreadPool::instance().run(boost::bind(&Thinning::checkCandidates, this, _1, boost::cref(im), table, count),
+			count, threads, count);
+	collect(im, removed);
+}
+
+void Thinning::checkRows(const cv::Range & parts, const cv::Mat & im, Table table, int count) {
+	const uchar * lut = m_tables[table];
+	const uchar * data = im.data;
+	const int w = im.cols;
+	const int rows = im.rows - 2;
+
+	for (int k = parts.start; k < parts.end; ++k) {
+		std::vector<int> & found = m_found[k];
+		found.clear();
+		for (int y = 1 + (long long)k * rows / count; y < 1 + (long long)(k + 1) * rows / count; ++y) {
+			const uchar * row = im.ptr<uchar>(y);
+			for (int x = 1; x < w - 1; ++x) {
+				if (!row[x])
+					continue;
+				int p = y * w + x;
+				if (lut[neighbourhood(data, p, w)])
+					found.push_back(p);
+			}
+		}
+	}
+}
+
+void Thinning::checkCandidates(const cv::Range & parts, const cv::Mat & im, Table table, int count) {
+	const uchar * lut = m_tables[table];
+	const uchar * data = im.data;
+	const int w = im.cols;
+	const size_t n = m_candidates.size();
+
+	for (int k = parts.start; k < parts.end; ++k) {
+		std::vector<int> & found = m_found[k];
+		found.clear();
+		for (size_t i = k * n / count; i < (k + 1) * n / count; ++i) {
+			int p = m_candidates[i];
+			if (lut[neighbourhood(data, p, w)])
+				found.push_back(p);
+		}
+	}
+}
+
+int Thinning::partsFor(size_t size, int threads) {
+	if (threads == 1)
+		return 1;
+	int t = threads > 0 ? threads : Types::ThreadPool::hardwareThreads();
+	return (int)std::max<size_t>(std::min<size_t>(4 * t, size / MinPartSize), 1);
+}
+
+void Thinning::collect(cv::Mat & im, std::vector<int> & removed) {
+	removed.clear();
+	for (size_t k = 0; k < m_found.size(); ++k)
+		removed.insert(removed.end(), m_found[k].begin(), m_found[k].end());
+
+	for (size_t i = 0; i < removed.size(); ++i)
+		im.data[removed[i]] = 0;
+}
+
+}//: namespace Skeletonization
+}//: namespace Processors
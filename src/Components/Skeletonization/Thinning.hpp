@@ -0,0 +1,108 @@
+/*!
+ * \file Thinning.hpp
+ * \brief Parallel thinning of binary images - class declaration.
+ */
+
+#ifndef SKELETONIZATION_THINNING_HPP_
+#define SKELETONIZATION_THINNING_HPP_
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace Processors {
+namespace Skeletonization {
+
+/*!
+ * \class Thinning
+ * \brief Iterative thinning (Zhang-Suen or Guo-Hall) driven by lookup tables.
+ *
+ * Image is 8-bit, single channel and continuous, with object pixels set to 1 and
+ * background to 0. Pixels of the border are never removed.
+ *
+ * Decision whether the pixel is removed in the sub-iteration depends only on its
+ * 8 neighbours, so it is read from the table of all 256 neighbourhoods. After the
+ * first pass of each sub-iteration, only neighbours of the pixels removed in two
+ * previous sub-iterations are checked again - decision for other pixels can't change.
+ * Pixels are checked in parallel and removed afterwards, so the result doesn't
+ * depend on the number of threads.
+ */
+class Thinning {
+public:
+	enum Algorithm {
+		ZhangSuen,
+		GuoHall
+	};
+
+	Thinning();
+
+	/*!
+	 * Thins objects of the image until no more pixels can be removed.
+	 *
+	 * \param threads number of threads (0 - all cores)
+	 */
+	void thin(cv::Mat & im, Algorithm algorithm, int threads);
+
+	/*!
+	 * Removes staircases (pixels whose removal leaves 8-connected line), first of the
+	 * lines going north, then south.
+	 */
+	void removeStairs(cv::Mat & im, int threads);
+
+	/// Number of sub-iterations of the last thinning.
+	int subiterations() const {
+		return m_subiterations;
+	}
+
+	/// Converts algorithm name (zhang_suen, guo_hall) to enum, unknown names give ZhangSuen.
+	static Algorithm algorithmFromString(const std::string & name);
+
+private:
+	enum Table {
+		ZhangSuen1,
+		ZhangSuen2,
+		GuoHall1,
+		GuoHall2,
+		StairNorth,
+		StairSouth,
+		Tables
+	};
+
+	/// Removes pixels of the whole image, marked in given table.
+	void pass(cv::Mat & im, Table table, int threads, std::vector<int> & removed);
+
+	/// Removes pixels from the candidates list, marked in given table.
+	void passCandidates(cv::Mat & im, Table table, int threads, std::vector<int> & removed);
+
+	/// Checks given parts (of count) of the image rows.
+	void checkRows(const cv::Range & parts, const cv::Mat & im, Table table, int count);
+
+	/// Checks given parts (of count) of the candidates.
+	void checkCandidates(const cv::Range & parts, const cv::Mat & im, Table table, int count);
+
+	/// Number of parts of the work of given size.
+	static int partsFor(size_t size, int threads);
+
+	/// Removes pixels found by the parts, returns them in removed.
+	void collect(cv::Mat & im, std::vector<int> & removed);
+
+	/// Neighbourhoods of removed pixels, for every table.
+	uchar m_tables[Tables][256];
+
+	/// Pixels removed by each part.
+	std::vector<std::vector<int> > m_found;
+
+	/// Pixels to be checked.
+	std::vector<int> m_candidates;
+
+	/// Marks of pixels already added to candidates.
+	std::vector<uchar> m_marks;
+
+	int m_subiterations;
+};
+
+}//: namespace Skeletonization
+}//: namespace Processors
+
+#endif /* SKELETONIZATION_THINNING_HPP_ */
@@ -9,6 +9,8 @@
 
 #include "Sum.hpp"
 #include "Common/Logger.hpp"
+#include "Types/Instrumentation.hpp"
+#include "Types/ParallelFor.hpp"
 
 #include <boost/bind.hpp>
 
@@ -17,11 +19,14 @@ namespace Sum {
 
 Sum::Sum(const std::string & name) :
 		Base::Component(name),
-		norm("norm", 1)
+		norm("norm", 1),
+		threads("threads", 1)
 {
 	LOG(LTRACE) << "Hello Sum\n";
 
 	registerProperty(norm);
+	threads.setToolTip("Number of threads processing the image (0 - all cores)");
+	registerProperty(threads);
 }
 
 Sum::~Sum() {
@@ -56,23 +61,33 @@ bool Sum::onStart() {
 	return true;
 }
 
+void Sum::sumRows(const cv::Range & rows, const cv::Mat & img1, const cv::Mat & img2)
+{
+	// Same as (img1 + img2) * norm, computed in place.
+	cv::Mat dst = tmp.rowRange(rows);
+	cv::addWeighted(img1.rowRange(rows), norm, img2.rowRange(rows), norm, 0, dst);
+}
+
 void Sum::onNewImage()
 {
 	LOG(LTRACE) << "Sum::onNewImage\n";
+	INSTRUMENT_HANDLER(probe, "onNewImage");
 	try {
 		cv::Mat img1 = in_img1.read();
-		cv::Mat img2 = in_img2.read().clone();
+		cv::Mat img2 = in_img2.read();
+		probe.bytesIn(img1);
+		probe.bytesIn(img2);
 
-		// TODO: add comparison of size1 & size2.
-		//cv::Size size = img1.size();
+		CV_Assert(img1.size() == img2.size() && img1.type() == img2.type());
 
-		// Create a matrix with the adequate size and depth.
-		tmp.create(img1.size(), img1.depth());
+		// Create a matrix with the adequate size and type.
+		tmp.create(img1.size(), img1.type());
 
-		// Sum the images (normalized).
-		tmp = (img1 + img2) * norm;
+		// Sum the images (normalized), in bands of rows.
+		Types::parallelRows(img1.rows, threads, boost::bind(&Sum::sumRows, this, _1, boost::cref(img1), boost::cref(img2)));
 
 		// Write the result to the output.
+		probe.bytesOut(tmp);
 		out_img.write(tmp);
 	} catch (...) {
 		LOG(LERROR) << "Sum::onNewImage failed\n";
@@ -26,7 +26,7 @@ using namespace cv;
  * \class Sum
  * \brief Sum processor class.
  *
- * Sum processor.
+ * Sum processor. Bands of rows can be summed in parallel, by threads number of threads.
  */
 class Sum: public Base::Component {
 public:
@@ -74,6 +74,9 @@ protected:
 	 */
 	void onNewImage();
 
+	/// Sums given rows of the images.
+	void sumRows(const cv::Range & rows, const cv::Mat & img1, const cv::Mat & img2);
+
 	/// Input data streams
 	Base::DataStreamIn <Mat, Base::DataStreamBuffer::Newest> in_img1;
 	Base::DataStreamIn <Mat, Base::DataStreamBuffer::Newest> in_img2;
@@ -84,6 +87,9 @@ protected:
 	// A normalizer, by which the sum will be multipiled.
 	Base::Property<double> norm;
 
+	/// Number of threads.
+	Base::Property<int> threads;
+
 private:
 	cv::Mat tmp;
 
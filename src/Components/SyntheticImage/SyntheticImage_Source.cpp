@@ -0,0 +1,150 @@
+/*!
+ * \file SyntheticImage_Source.cpp
+ * \brief Source of generated (or loaded once) images, used for benchmarking
+ */
+
+#include "SyntheticImage_Source.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace Sources {
+namespace SyntheticImage {
+
+SyntheticImage_Source::SyntheticImage_Source(const std::string & name) :
+	Base::Component(name),
+	pool(4),
+	published(0),
+	width("width", 640),
+	height("height", 480),
+	channels("channels", 3),
+	pattern("pattern", std::string("noise")),
+	filename("filename", std::string("")),
+	frames("frames", 0),
+	seed("seed", 0)
+{
+	registerProperty(width);
+	registerProperty(height);
+	registerProperty(channels);
+	registerProperty(pattern);
+	registerProperty(filename);
+	registerProperty(frames);
+	registerProperty(seed);
+}
+
+SyntheticImage_Source::~SyntheticImage_Source() {
+}
+
+void SyntheticImage_Source::prepareInterface() {
+	registerStream("out_img", &out_img);
+	registerStream("out_timestamp", &out_timestamp);
+	registerStream("out_end_of_sequence_trigger", &out_end_of_sequence_trigger);
+
+	registerHandler("onStep", boost::bind(&SyntheticImage_Source::onStep, this));
+	addDependency("onStep", NULL);
+}
+
+bool SyntheticImage_Source::onInit() {
+	pattern_img = generate();
+	if (pattern_img.empty()) {
+		CLOG(LERROR) << name() << ": can't create image";
+		return false;
+	}
+
+	CLOG(LINFO) << name() << ": " << pattern_img.cols << "x" << pattern_img.rows << "x" << pattern_img.channels()
+			<< " " << (std::string(filename).empty() ? std::string(pattern) : std::string(filename));
+	return true;
+}
+
+bool SyntheticImage_Source::onFinish() {
+	CLOG(LINFO) << name() << ": " << published << " frames published, pool: " << pool.allocations()
+			<< " allocations for " << pool.requests() << " frames";
+	pattern_img.release();
+	pool.clear();
+	return true;
+}
+
+bool SyntheticImage_Source::onStart() {
+	published = 0;
+	pool.resetCounters();
+	return true;
+}
+
+bool SyntheticImage_Source::onStop() {
+	return true;
+}
+
+void SyntheticImage_Source::onStep() {
+	if (pattern_img.empty() || (frames > 0 && published >= frames))
+		return;
+
+	cv::Mat img = pool.acquire(pattern_img.size(), pattern_img.type());
+	pattern_img.copyTo(img);
+
+	boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+	boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+	out_timestamp.write((now - epoch).total_microseconds() / 1e6);
+	out_img.write(img);
+
+	if (++published == frames)
+		out_end_of_sequence_trigger.write(Base::UnitType());
+}
+
+cv::Mat SyntheticImage_Source::generate() {
+	int w = width, h = height;
+	int type = (channels == 1) ? CV_8UC1 : CV_8UC3;
+
+	if (!std::string(filename).empty()) {
+		cv::Mat img = cv::imread(filename, channels == 1 ? 0 : 1);
+		if (!img.empty() && w > 0 && h > 0)
+			cv::resize(img, img, cv::Size(w, h), 0, 0, cv::INTER_AREA);
+		return img;
+	}
+
+	if (w <= 0 || h <= 0)
+		return cv::Mat();
+
+	cv::RNG rng((unsigned)seed + 1);
+	cv::Mat img(h, w, type, cv::Scalar::all(0));
+	std::string p = pattern;
+
+	if (p == "gradient") {
+		for (int y = 0; y < h; ++y) {
+			uchar * row = img.ptr<uchar>(y);
+			for (int x = 0; x < w; ++x)
+				for (int c = 0; c < img.channels(); ++c)
+					row[x * img.channels() + c] = cv::saturate_cast<uchar>(
+							c == 0 ? x * 255 / w : c == 1 ? y * 255 / h : (x + y) * 255 / (w + h));
+		}
+	} else if (p == "checkerboard") {
+		for (int y = 0; y < h; ++y) {
+			uchar * row = img.ptr<uchar>(y);
+			for (int x = 0; x < w; ++x)
+				if (((x / 32) + (y / 32)) % 2)
+					for (int c = 0; c < img.channels(); ++c)
+						row[x * img.channels() + c] = 255;
+		}
+	} else if (p == "blobs") {
+		int count = std::max(1, (w * h) / (80 * 80));
+		for (int i = 0; i < count; ++i) {
+			cv::Point center(rng.uniform(0, w), rng.uniform(0, h));
+			int radius = rng.uniform(4, std::max(5, std::min(w, h) / 10));
+			cv::circle(img, center, radius, cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256)), -1);
+		}
+	} else {
+		if (p != "noise")
+			CLOG(LWARNING) << name() << ": unknown pattern " << p << ", using noise";
+		rng.fill(img, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+	}
+
+	return img;
+}
+
+}//: namespace SyntheticImage
+}//: namespace Sources
@@ -0,0 +1,155 @@
+/*!
+ * \file SyntheticImage_Source.hpp
+ * \brief Source of generated (or loaded once) images, used for benchmarking
+ */
+
+#ifndef SYNTHETICIMAGE_SOURCE_HPP_
+#define SYNTHETICIMAGE_SOURCE_HPP_
+
+#include "Component_Aux.hpp"
+#include "Component.hpp"
+#include "DataStream.hpp"
+#include "Property.hpp"
+
+#include "Types/FramePool.hpp"
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * \defgroup SyntheticImage SyntheticImage
+ * \ingroup Sources
+ *
+ * Publishes the same image in every step, as fast as the executor allows, so that
+ * the processors connected to it can be benchmarked without the cost of decoding
+ * or grabbing frames. Image is generated once (or loaded from file and resized),
+ * and copied to the buffer from the pool before publishing, so processors working
+ * in place don't change it.
+ *
+ * Patterns: "noise" (uniform), "gradient", "checkerboard" (32 pixel squares) or
+ * "blobs" (random filled circles on black background).
+ *
+ *
+ * \par Data streams:
+ *
+ * \streamout{out_img,cv::Mat}
+ * Output image
+ * \streamout{out_timestamp,double}
+ * Time of publishing the image (in seconds since epoch), written before the image
+ * \streamout{out_end_of_sequence_trigger,Base::UnitType}
+ * Written once, after the last frame
+ *
+ *
+ * \par Properties:
+ *
+ * \prop{width,int,640}
+ * Image width
+ * \prop{height,int,480}
+ * Image height
+ * \prop{channels,int,3}
+ * Number of channels (1 or 3, 8-bit)
+ * \prop{pattern,string,"noise"}
+ * Generated pattern
+ * \prop{filename,string,""}
+ * Image file used instead of the pattern (resized to width x height, if both are set)
+ * \prop{frames,int,0}
+ * Number of published frames, 0 - no limit
+ * \prop{seed,int,0}
+ * Seed of the random generator
+ *
+ * @{
+ *
+ * @}
+ */
+
+namespace Sources {
+namespace SyntheticImage {
+
+/*!
+ * \class SyntheticImage_Source
+ * \brief Publishes generated image in every step.
+ */
+class SyntheticImage_Source: public Base::Component {
+public:
+	/*!
+	 * Constructor.
+	 */
+	SyntheticImage_Source(const std::string & name = "SyntheticImage");
+
+	/*!
+	 * Destructor
+	 */
+	virtual ~SyntheticImage_Source();
+
+	/*!
+	 * Prepare components interface (register streams and handlers).
+	 */
+	void prepareInterface();
+
+protected:
+
+	/*!
+	 * Generates the image.
+	 */
+	bool onInit();
+
+	/*!
+	 * Releases the image.
+	 */
+	bool onFinish();
+
+	/*!
+	 * Start component
+	 */
+	bool onStart();
+
+	/*!
+	 * Stop component
+	 */
+	bool onStop();
+
+	/*!
+	 * Event handler function - publishes next frame.
+	 */
+	void onStep();
+
+	/// Creates the image according to the properties.
+	cv::Mat generate();
+
+	/// Output image.
+	Base::DataStreamOut<cv::Mat> out_img;
+
+	/// Output data stream - time of publishing the image.
+	Base::DataStreamOut<double> out_timestamp;
+
+	/// Output event - all frames published.
+	Base::DataStreamOut<Base::UnitType> out_end_of_sequence_trigger;
+
+	/// Published image.
+	cv::Mat pattern_img;
+
+	/// Buffers of published copies.
+	Types::FramePool pool;
+
+	/// Number of frames published so far.
+	long published;
+
+	Base::Property<int> width;
+	Base::Property<int> height;
+	Base::Property<int> channels;
+	Base::Property<std::string> pattern;
+	Base::Property<std::string> filename;
+	Base::Property<int> frames;
+	Base::Property<int> seed;
+};
+
+}//: namespace SyntheticImage
+}//: namespace Sources
+
+/*
+ * Register source component.
+ */
+REGISTER_COMPONENT("SyntheticImage", Sources::SyntheticImage::SyntheticImage_Source)
+
+#endif /* SYNTHETICIMAGE_SOURCE_HPP_ */
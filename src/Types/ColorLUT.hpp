@@ -0,0 +1,224 @@
+/*!
+ * \file ColorLUT.hpp
+ * \brief Segmentation of 3-channel images into colour classes with precomputed lookup table
+ */
+
+#ifndef COLORLUT_HPP_
+#define COLORLUT_HPP_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <opencv2/core/core.hpp>
+
+#include "RangeMask.hpp"
+
+namespace Types {
+
+/*!
+ * \class ColorLUT
+ * \brief Lookup table assigning class to each of 2^24 colours.
+ *
+ * Table (16 MB) holds one byte for every colour, indexed by the three channel values -
+ * label of the first class, which contains the colour (1 for the first class, 0 - none),
+ * so every pixel needs single lookup, regardless of the number of classes.
+ * Table is rebuilt only when the classes change.
+ */
+class ColorLUT {
+public:
+	/// Maximum number of classes (labels are 8-bit).
+	enum { MaxClasses = 255 };
+
+	/// Number of colours (entries of the table).
+	enum { TableSize = 1 << 24 };
+
+	ColorLUT() {
+	}
+
+	/*!
+	 * Sets classes, rebuilding the table if they differ from the current ones.
+	 * Only the first MaxClasses classes are used.
+	 *
+	 * \return true if the table was rebuilt
+	 */
+	bool setClasses(const std::vector<RangeMask> & classes) {
+		// Classes over the limit are dropped before comparing, otherwise they would never match.
+		size_t count = std::min(classes.size(), (size_t)MaxClasses);
+		if (count == m_classes.size() && std::equal(classes.begin(), classes.begin() + count, m_classes.begin()))
+			return false;
+
+		m_classes.assign(classes.begin(), classes.begin() + count);
+		m_labels.assign(TableSize, 0);
+
+		// Classes are written from the last one, so the first matching class overwrites the others.
+		for (size_t k = m_classes.size(); k > 0; --k)
+			build(m_classes[k - 1], k);
+		return true;
+	}
+
+	size_t classes() const {
+		return m_classes.size();
+	}
+
+	/*!
+	 * Labels pixels of the image.
+	 *
+	 * \param src 8-bit, 3-channel image
+	 * \param labels 8-bit label image, (re)allocated if needed
+	 * \param mask if given, set to 255 for pixels of any class, 0 otherwise
+	 */
+	void apply(const cv::Mat & src, cv::Mat & labels, cv::Mat * mask = NULL) const {
+		CV_Assert(src.type() == CV_8UC3);
+		labels.create(src.size(), CV_8UC1);
+		if (mask)
+			mask->create(src.size(), CV_8UC1);
+
+		if (m_labels.empty()) {
+			labels.setTo(cv::Scalar(0));
+			if (mask)
+				mask->setTo(cv::Scalar(0));
+			return;
+		}
+
+		const uchar * table = &m_labels[0];
+		for (int y = 0; y < src.rows; ++y) {
+			const uchar * p = src.ptr<uchar>(y);
+			uchar * l = labels.ptr<uchar>(y);
+			uchar * m = mask ? mask->ptr<uchar>(y) : NULL;
+
+			for (int x = 0; x < src.cols; ++x, p += 3) {
+				uchar label = table[((size_t)p[0] << 16) | ((size_t)p[1] << 8) | p[2]];
+				l[x] = label;
+				if (m)
+					m[x] = label ? 255 : 0;
+			}
+		}
+	}
+
+	/*!
+	 * Parses list of classes, in form "low-high,low-high,low-high;..." (ranges of
+	 * the three channels of consecutive classes, separated by semicolons, bounds 0..255).
+	 *
+	 * \throws std::runtime_error if the list is malformed, with description of the problem
+	 */
+	static std::vector<RangeMask> parse(const std::string & list) {
+		std::vector<RangeMask> result;
+
+		std::vector<std::string> classes;
+		std::string l = boost::trim_copy(list);
+		if (l.empty())
+			return result;
+		boost::split(classes, l, boost::is_any_of(";"));
+
+		for (size_t k = 0; k < classes.size(); ++k) {
+			std::vector<std::string> channels;
+			boost::split(channels, classes[k], boost::is_any_of(","));
+			if (channels.size() != 3)
+				throw std::runtime_error("Colour class should have 3 ranges: " + classes[k]);
+
+			RangeMask r;
+			for (int c = 0; c < 3; ++c) {
+				std::vector<std::string> bounds;
+				boost::split(bounds, channels[c], boost::is_any_of("-"));
+				if (bounds.size() != 2)
+					throw std::runtime_error("Range should be given as low-high: " + channels[c]);
+				r.setRange(c, parseBound(bounds[0], channels[c]), parseBound(bounds[1], channels[c]));
+			}
+			result.push_back(r);
+		}
+
+		return result;
+	}
+
+private:
+	/// Parses single bound of the range.
+	static int parseBound(const std::string & bound, const std::string & range) {
+		int value;
+		try {
+			value = boost::lexical_cast<int>(boost::trim_copy(bound));
+		} catch (boost::bad_lexical_cast &) {
+			throw std::runtime_error("Bound of the range is not a number: " + range);
+		}
+		if (value < 0 || value > 255)
+			throw std::runtime_error("Bound of the range is outside of 0-255: " + range);
+		return value;
+	}
+
+	/// Writes label of the class - ranges are separable, so matching part of the third channel is the same in every row.
+	void build(const RangeMask & r, size_t label) {
+		std::vector<int> row;
+		for (int c2 = 0; c2 < 256; ++c2)
+			if (r.channelMatches(2, c2))
+				row.push_back(c2);
+
+		for (int c0 = 0; c0 < 256; ++c0) {
+			if (!r.channelMatches(0, c0))
+				continue;
+			for (int c1 = 0; c1 < 256; ++c1) {
+				if (!r.channelMatches(1, c1))
+					continue;
+				uchar * dst = &m_labels[(c0 << 16) | (c1 << 8)];
+				for (size_t i = 0; i < row.size(); ++i)
+					dst[row[i]] = (uchar)label;
+			}
+		}
+	}
+
+	std::vector<RangeMask> m_classes;
+
+	/// Label of every colour.
+	std::vector<uchar> m_labels;
+};
+
+/*!
+ * \class ColorClassList
+ * \brief Classes given as the text property, parsed only when the text changes.
+ */
+class ColorClassList {
+public:
+	ColorClassList() : m_parsed(false) {
+	}
+
+	/*!
+	 * Parses the list, if it differs from the previous one.
+	 *
+	 * \param error set to the description of the problem if the list is malformed
+	 * (then it gives no classes), cleared otherwise
+	 * \return true if the list has changed
+	 */
+	bool update(const std::string & list, std::string & error) {
+		error.clear();
+		if (m_parsed && list == m_list)
+			return false;
+
+		m_list = list;
+		m_parsed = true;
+		try {
+			m_classes = ColorLUT::parse(list);
+		} catch (std::exception & ex) {
+			m_classes.clear();
+			error = ex.what();
+		}
+		return true;
+	}
+
+	const std::vector<RangeMask> & classes() const {
+		return m_classes;
+	}
+
+private:
+	std::string m_list;
+
+	bool m_parsed;
+
+	std::vector<RangeMask> m_classes;
+};
+
+} //: namespace Types
+
+#endif /* COLORLUT_HPP_ */
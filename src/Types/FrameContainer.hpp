@@ -0,0 +1,397 @@
+/*!
+ * \file FrameContainer.hpp
+ * \brief Indexed binary container of raw cv::Mat frames
+ */
+
+#ifndef FRAMECONTAINER_HPP_
+#define FRAMECONTAINER_HPP_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Types {
+
+/*!
+ * Layout of the container file:
+ * - file header,
+ * - frames, each consisting of frame header followed by raw (continuous) pixel data,
+ *   aligned to FrameContainer::Alignment bytes,
+ * - index - table of frame header offsets followed by the trailer.
+ *
+ * Index is written when the container is closed. If it is missing (e.g. the
+ * recording was interrupted), frames are recovered by scanning frame headers.
+ */
+namespace FrameContainer {
+
+/// Extension of container files.
+static const char * const Extension = "cvraw";
+
+/// Alignment of frame payload (relative to the beginning of file).
+static const boost::uint64_t Alignment = 64;
+
+struct FileHeader {
+	char magic[8];
+	boost::uint32_t version;
+	boost::uint32_t reserved;
+};
+
+struct FrameHeader {
+	boost::uint32_t magic;
+	boost::int32_t type;
+	boost::int32_t rows;
+	boost::int32_t cols;
+	boost::uint64_t bytes;
+	boost::uint64_t reserved;
+};
+
+struct Trailer {
+	boost::uint64_t count;
+	boost::uint64_t index_offset;
+	char magic[8];
+};
+
+static const char FileMagic[8] = { 'D', 'C', 'L', 'R', 'A', 'W', '0', '1' };
+static const char IndexMagic[8] = { 'D', 'C', 'L', 'R', 'A', 'W', 'I', 'X' };
+static const boost::uint32_t FrameMagic = 0x4D415246; // "FRAM"
+static const boost::uint32_t Version = 1;
+
+inline boost::uint64_t align(boost::uint64_t offset) {
+	return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+/*!
+ * Checks if the frame at given offset lies inside the file of given size - header,
+ * payload and pixels of the image described by the header.
+ */
+inline bool validFrame(const char * data, boost::uint64_t size, boost::uint64_t offset) {
+	if (offset < sizeof(FileHeader) || offset > size || size - offset < sizeof(FrameHeader))
+		return false;
+
+	FrameHeader header;
+	std::memcpy(&header, data + offset, sizeof(header));
+	if (header.magic != FrameMagic || header.rows < 0 || header.cols < 0 ||
+			CV_MAT_DEPTH(header.type) > CV_64F || header.type != CV_MAKETYPE(CV_MAT_DEPTH(header.type), CV_MAT_CN(header.type)))
+		return false;
+
+	boost::uint64_t payload = align(offset + sizeof(FrameHeader));
+	if (payload > size || size - payload < header.bytes)
+		return false;
+
+	// Rows are compared with bytes first, so the product can't overflow.
+	if (header.cols > 0 && (boost::uint64_t)header.rows > header.bytes / header.cols)
+		return false;
+	return (boost::uint64_t)header.rows * header.cols * CV_ELEM_SIZE(header.type) <= header.bytes;
+}
+
+/*!
+ * \class RegionAllocator
+ * \brief Reference counting of images pointing into mapped container.
+ *
+ * Image attached to the region keeps it mapped until the last copy of the image is
+ * released, even when the reader was closed in the meantime. Images later created
+ * in such Mat (which inherits the allocator) get ordinary heap memory.
+ */
+class RegionAllocator : public cv::MatAllocator {
+public:
+	static RegionAllocator * instance() {
+		static RegionAllocator allocator;
+		return &allocator;
+	}
+
+	/// Makes image refer to the region.
+	void attach(cv::Mat & img, const boost::shared_ptr<boost::interprocess::mapped_region> & region) {
+		Block * block = new Block;
+		block->refcount = 1;
+		block->region = region;
+		block->memory = NULL;
+		img.refcount = &block->refcount;
+		img.allocator = this;
+	}
+
+	void allocate(int dims, const int * sizes, int type, int *& refcount, uchar *& datastart, uchar *& data, size_t * step) {
+		step[dims - 1] = CV_ELEM_SIZE(type);
+		for (int i = dims - 1; i > 0; --i)
+			step[i - 1] = step[i] * sizes[i];
+
+		Block * block = new Block;
+		block->refcount = 1;
+		block->memory = (uchar *)cv::fastMalloc(step[0] * sizes[0]);
+		refcount = &block->refcount;
+		datastart = data = block->memory;
+	}
+
+	void deallocate(int * refcount, uchar *, uchar *) {
+		// Counter is the first member of the block.
+		Block * block = reinterpret_cast<Block *>(refcount);
+		if (block->memory)
+			cv::fastFree(block->memory);
+		delete block;
+	}
+
+private:
+	struct Block {
+		int refcount;
+		boost::shared_ptr<boost::interprocess::mapped_region> region;
+		uchar * memory;
+	};
+};
+
+} //: namespace FrameContainer
+
+/*!
+ * \class FrameContainerWriter
+ * \brief Appends frames to container file.
+ */
+class FrameContainerWriter {
+public:
+	FrameContainerWriter() : m_pos(0) {}
+
+	~FrameContainerWriter() {
+		close();
+	}
+
+	/*!
+	 * Creates new container (existing file is truncated).
+	 */
+	bool open(const std::string & fname) {
+		close();
+
+		m_file.open(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open())
+			return false;
+		m_fname = fname;
+
+		FrameContainer::FileHeader header;
+		std::memcpy(header.magic, FrameContainer::FileMagic, sizeof(header.magic));
+		header.version = FrameContainer::Version;
+		header.reserved = 0;
+		m_file.write((const char *)&header, sizeof(header));
+		m_pos = sizeof(header);
+		m_offsets.clear();
+
+		return m_file.good();
+	}
+
+	bool isOpened() const {
+		return m_file.is_open();
+	}
+
+	/// Name of the last successfully opened container file.
+	const std::string & fileName() const {
+		return m_fname;
+	}
+
+	/*!
+	 * Appends frame to the container.
+	 */
+	bool write(const cv::Mat & img) {
+		if (!m_file.is_open())
+			return false;
+
+		size_t row_bytes = img.cols * img.elemSize();
+
+		FrameContainer::FrameHeader header;
+		header.magic = FrameContainer::FrameMagic;
+		header.type = img.type();
+		header.rows = img.rows;
+		header.cols = img.cols;
+		header.bytes = (boost::uint64_t)row_bytes * img.rows;
+		header.reserved = 0;
+
+		m_offsets.push_back(m_pos);
+		m_file.write((const char *)&header, sizeof(header));
+		m_pos += sizeof(header);
+		pad();
+
+		if (img.isContinuous()) {
+			m_file.write((const char *)img.data, header.bytes);
+		} else {
+			for (int i = 0; i < img.rows; ++i)
+				m_file.write((const char *)img.ptr(i), row_bytes);
+		}
+		m_pos += header.bytes;
+
+		return m_file.good();
+	}
+
+	/// Number of frames written so far.
+	size_t size() const {
+		return m_offsets.size();
+	}
+
+	/*!
+	 * Writes index and closes the file.
+	 */
+	void close() {
+		if (!m_file.is_open())
+			return;
+
+		FrameContainer::Trailer trailer;
+		trailer.count = m_offsets.size();
+		trailer.index_offset = m_pos;
+		std::memcpy(trailer.magic, FrameContainer::IndexMagic, sizeof(trailer.magic));
+
+		if (!m_offsets.empty())
+			m_file.write((const char *)&m_offsets[0], m_offsets.size() * sizeof(boost::uint64_t));
+		m_file.write((const char *)&trailer, sizeof(trailer));
+		m_file.close();
+		m_offsets.clear();
+	}
+
+private:
+	/// Fills the file with zeros up to the next aligned offset.
+	void pad() {
+		static const char zeros[FrameContainer::Alignment] = { 0 };
+		boost::uint64_t next = FrameContainer::align(m_pos);
+		m_file.write(zeros, next - m_pos);
+		m_pos = next;
+	}
+
+	std::ofstream m_file;
+
+	std::string m_fname;
+
+	boost::uint64_t m_pos;
+
+	std::vector<boost::uint64_t> m_offsets;
+};
+
+/*!
+ * \class FrameContainerReader
+ * \brief Maps container file into memory and gives access to its frames without copying.
+ *
+ * File is mapped copy-on-write, so returned images can be modified in place without
+ * touching the file. Images keep the mapping alive, so they stay valid after the reader
+ * is closed or destroyed.
+ *
+ * Frame headers (from the index or found by scanning) are validated when the file
+ * is opened, so broken or truncated files never give images outside of the mapping.
+ */
+class FrameContainerReader {
+public:
+	FrameContainerReader() {}
+
+	bool open(const std::string & fname) {
+		close();
+
+		try {
+			m_mapping.reset(new boost::interprocess::file_mapping(fname.c_str(), boost::interprocess::read_only));
+			m_region.reset(new boost::interprocess::mapped_region(*m_mapping, boost::interprocess::copy_on_write));
+		} catch (...) {
+			close();
+			return false;
+		}
+
+		const char * data = (const char *)m_region->get_address();
+		boost::uint64_t size = m_region->get_size();
+
+		if (size < sizeof(FrameContainer::FileHeader) ||
+				std::memcmp(data, FrameContainer::FileMagic, sizeof(FrameContainer::FileMagic)) != 0) {
+			close();
+			return false;
+		}
+
+		if (!readIndex(data, size))
+			scanFrames(data, size);
+
+		// Neither index nor frame headers were found in non-empty file.
+		if (m_offsets.empty() && size > sizeof(FrameContainer::FileHeader) + sizeof(FrameContainer::Trailer)) {
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void close() {
+		m_offsets.clear();
+		m_region.reset();
+		m_mapping.reset();
+	}
+
+	bool isOpened() const {
+		return m_region.get() != NULL;
+	}
+
+	/// Number of frames in the container.
+	size_t size() const {
+		return m_offsets.size();
+	}
+
+	/*!
+	 * Returns i-th frame, referencing mapped memory.
+	 */
+	cv::Mat frame(size_t i) const {
+		if (i >= m_offsets.size())
+			return cv::Mat();
+
+		char * data = (char *)m_region->get_address();
+		const FrameContainer::FrameHeader * header = (const FrameContainer::FrameHeader *)(data + m_offsets[i]);
+		char * payload = data + FrameContainer::align(m_offsets[i] + sizeof(FrameContainer::FrameHeader));
+
+		cv::Mat img(header->rows, header->cols, header->type, payload);
+		FrameContainer::RegionAllocator::instance()->attach(img, m_region);
+		return img;
+	}
+
+private:
+	/// Reads index written by the writer, returns false if it is missing or broken.
+	bool readIndex(const char * data, boost::uint64_t size) {
+		if (size < sizeof(FrameContainer::FileHeader) + sizeof(FrameContainer::Trailer))
+			return false;
+
+		FrameContainer::Trailer trailer;
+		std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+		if (std::memcmp(trailer.magic, FrameContainer::IndexMagic, sizeof(trailer.magic)) != 0)
+			return false;
+
+		// Count is checked first, so the sum can't overflow.
+		if (trailer.count > size / sizeof(boost::uint64_t) || trailer.index_offset > size ||
+				trailer.index_offset + trailer.count * sizeof(boost::uint64_t) + sizeof(trailer) != size)
+			return false;
+
+		m_offsets.resize(trailer.count);
+		if (trailer.count > 0)
+			std::memcpy(&m_offsets[0], data + trailer.index_offset, trailer.count * sizeof(boost::uint64_t));
+
+		for (size_t i = 0; i < m_offsets.size(); ++i) {
+			if (!FrameContainer::validFrame(data, trailer.index_offset, m_offsets[i])) {
+				m_offsets.clear();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// Recovers frame offsets by walking through frame headers.
+	void scanFrames(const char * data, boost::uint64_t size) {
+		m_offsets.clear();
+
+		boost::uint64_t pos = sizeof(FrameContainer::FileHeader);
+		while (FrameContainer::validFrame(data, size, pos)) {
+			const FrameContainer::FrameHeader * header = (const FrameContainer::FrameHeader *)(data + pos);
+			m_offsets.push_back(pos);
+			pos = FrameContainer::align(pos + sizeof(FrameContainer::FrameHeader)) + header->bytes;
+		}
+	}
+
+	boost::shared_ptr<boost::interprocess::file_mapping> m_mapping;
+
+	boost::shared_ptr<boost::interprocess::mapped_region> m_region;
+
+	std::vector<boost::uint64_t> m_offsets;
+};
+
+} //: namespace Types
+
+#endif /* FRAMECONTAINER_HPP_ */
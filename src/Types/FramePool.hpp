@@ -0,0 +1,161 @@
+/*!
+ * \file FramePool.hpp
+ * \brief Pool of recycled image buffers
+ */
+
+#ifndef FRAMEPOOL_HPP_
+#define FRAMEPOOL_HPP_
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Types {
+
+/*!
+ * \class FramePool
+ * \brief Set of image buffers reused by the source for consecutive frames.
+ *
+ * Pool keeps a reference to every buffer it has allocated. Buffer is free again
+ * when all other references (held by the components downstream) are released,
+ * so the source may decode next frame into it, without touching the heap.
+ *
+ * When all buffers are in use and the pool is full, free buffer of different
+ * geometry is replaced, and if there is none, image is allocated outside the pool.
+ *
+ * All methods are thread-safe.
+ */
+class FramePool {
+public:
+	/*!
+	 * \param capacity maximum number of buffers kept in the pool
+	 */
+	FramePool(size_t capacity = 8) : m_capacity(capacity) {
+		resetCounters();
+	}
+
+	/*!
+	 * Sets maximum number of buffers kept in the pool. Surplus free buffers are released.
+	 */
+	void setCapacity(size_t capacity) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_capacity = capacity;
+		for (size_t i = m_buffers.size(); i > 0 && m_buffers.size() > m_capacity; --i) {
+			if (isFree(m_buffers[i-1]))
+				m_buffers.erase(m_buffers.begin() + (i-1));
+		}
+	}
+
+	/*!
+	 * Returns buffer of given size and type, reusing free one if possible.
+	 * Content of the returned image is undefined. For empty size (e.g. geometry
+	 * of the first frame isn't known yet) empty image is returned.
+	 */
+	cv::Mat acquire(int rows, int cols, int type) {
+		if (rows <= 0 || cols <= 0)
+			return cv::Mat();
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		++m_requests;
+
+		int replace = -1;
+		for (size_t i = 0; i < m_buffers.size(); ++i) {
+			const cv::Mat & buf = m_buffers[i];
+			if (!isFree(buf))
+				continue;
+			if (buf.rows == rows && buf.cols == cols && buf.type() == type)
+				return buf;
+			replace = i;
+		}
+
+		++m_allocations;
+		cv::Mat img(rows, cols, type);
+		if (m_buffers.size() < m_capacity)
+			m_buffers.push_back(img);
+		else if (replace >= 0)
+			m_buffers[replace] = img;
+		else
+			++m_overflows;
+
+		return img;
+	}
+
+	cv::Mat acquire(cv::Size size, int type) {
+		return acquire(size.height, size.width, type);
+	}
+
+	/*!
+	 * Releases all buffers held by the pool (images still used downstream stay valid).
+	 */
+	void clear() {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_buffers.clear();
+	}
+
+	void resetCounters() {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_requests = 0;
+		m_allocations = 0;
+		m_overflows = 0;
+	}
+
+	/// Number of buffers kept in the pool.
+	size_t size() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_buffers.size();
+	}
+
+	/// Number of pool buffers referenced outside the pool.
+	size_t inUse() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		size_t n = 0;
+		for (size_t i = 0; i < m_buffers.size(); ++i)
+			if (!isFree(m_buffers[i]))
+				++n;
+		return n;
+	}
+
+	/// Number of acquire() calls.
+	unsigned long requests() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_requests;
+	}
+
+	/// Number of acquire() calls which had to allocate memory.
+	unsigned long allocations() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_allocations;
+	}
+
+	/// Number of images allocated outside the pool, because it was exhausted.
+	unsigned long overflows() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_overflows;
+	}
+
+private:
+	/// Returns true if only the pool references given buffer.
+	static bool isFree(const cv::Mat & buf) {
+#if CV_MAJOR_VERSION >= 3
+		return buf.u && buf.u->refcount == 1;
+#else
+		return buf.refcount && *buf.refcount == 1;
+#endif
+	}
+
+	std::vector<cv::Mat> m_buffers;
+
+	size_t m_capacity;
+
+	unsigned long m_requests;
+	unsigned long m_allocations;
+	unsigned long m_overflows;
+
+	mutable boost::mutex m_mutex;
+};
+
+} //: namespace Types
+
+#endif /* FRAMEPOOL_HPP_ */
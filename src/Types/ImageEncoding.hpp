@@ -0,0 +1,192 @@
+/*!
+ * \file ImageEncoding.hpp
+ * \brief Encoder settings and statistics of image writing
+ */
+
+#ifndef IMAGEENCODING_HPP_
+#define IMAGEENCODING_HPP_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "FrameContainer.hpp"
+
+namespace Types {
+
+/*!
+ * \class EncoderSettings
+ * \brief Parameters passed to cv::imwrite, depending on the format of the file.
+ *
+ * Negative values leave OpenCV defaults. If fast_lossless is set, images deeper
+ * than 8 bits (e.g. 16-bit depth maps) are stored without compression, in
+ * \ref Types::FrameContainerWriter "frame containers" (readable by Sequence),
+ * regardless of the requested format.
+ */
+struct EncoderSettings {
+	/// PNG compression level (0-9).
+	int png_compression;
+
+	/// JPEG quality (0-100).
+	int jpeg_quality;
+
+	/// WebP quality (1-100, above 100 - lossless).
+	int webp_quality;
+
+	/// TIFF compression scheme (libtiff code, e.g. 1 - none, 5 - LZW), OpenCV 3.4 or newer.
+	int tiff_compression;
+
+	/// Store images deeper than 8 bits uncompressed.
+	bool fast_lossless;
+
+	EncoderSettings() :
+		png_compression(-1), jpeg_quality(-1), webp_quality(-1), tiff_compression(-1), fast_lossless(false) {
+	}
+
+	/// Returns imwrite parameters for given format (file extension).
+	std::vector<int> params(const std::string & format) const {
+		std::string fmt = format;
+		std::transform(fmt.begin(), fmt.end(), fmt.begin(), ::tolower);
+
+		std::vector<int> p;
+		if (fmt == "png" && png_compression >= 0) {
+			p.push_back(CV_IMWRITE_PNG_COMPRESSION);
+			p.push_back(png_compression);
+		} else if ((fmt == "jpg" || fmt == "jpeg") && jpeg_quality >= 0) {
+			p.push_back(CV_IMWRITE_JPEG_QUALITY);
+			p.push_back(jpeg_quality);
+		} else if (fmt == "webp" && webp_quality >= 0) {
+			p.push_back(CV_IMWRITE_WEBP_QUALITY);
+			p.push_back(webp_quality);
+		}
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 4)
+		else if ((fmt == "tif" || fmt == "tiff") && tiff_compression >= 0) {
+			p.push_back(cv::IMWRITE_TIFF_COMPRESSION);
+			p.push_back(tiff_compression);
+		}
+#endif
+		return p;
+	}
+
+	/// Returns true if image should be written by the fast lossless path.
+	bool useFastLossless(const cv::Mat & img) const {
+		return fast_lossless && img.depth() != CV_8U && img.depth() != CV_8S;
+	}
+};
+
+/*!
+ * Writes image to file, according to the settings.
+ *
+ * In fast lossless mode images are appended to the given container - all images of
+ * the recording go to one file, opened (with name of the first image) when needed.
+ * Without the container every image is written to its own single frame container -
+ * Sequence keeps all containers of the directory mapped, so this suits only few images.
+ *
+ * \param fname name of the file, in fast lossless mode its extension is replaced with cvraw
+ * \param container container of the recording, may be NULL
+ * \return false if image couldn't be written
+ */
+inline bool writeImage(const std::string & fname, const std::string & format, const cv::Mat & img,
+		const EncoderSettings & settings, FrameContainerWriter * container = NULL) {
+	if (settings.useFastLossless(img)) {
+		std::string raw = fname.substr(0, fname.size() - format.size()) + FrameContainer::Extension;
+		FrameContainerWriter single;
+		FrameContainerWriter & writer = container ? *container : single;
+		if (!writer.isOpened() && !writer.open(raw))
+			return false;
+		return writer.write(img);
+	}
+
+	return cv::imwrite(fname, img, settings.params(format));
+}
+
+/*!
+ * \class EncodeStats
+ * \brief Time spent on encoding (and writing) images.
+ */
+class EncodeStats {
+public:
+	EncodeStats() {
+		reset();
+	}
+
+	void reset() {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_count = 0;
+		m_bytes = 0;
+		m_seconds = 0;
+		m_max = 0;
+	}
+
+	/// Adds single image, of given size (in memory), written in given time.
+	void add(double seconds, size_t bytes) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		++m_count;
+		m_bytes += bytes;
+		m_seconds += seconds;
+		m_max = std::max(m_max, seconds);
+	}
+
+	unsigned long count() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_count;
+	}
+
+	/// Average time of writing single image, in milliseconds.
+	double averageMs() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_count ? m_seconds * 1000 / m_count : 0;
+	}
+
+	/// Maximum time of writing single image, in milliseconds.
+	double maxMs() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_max * 1000;
+	}
+
+	/// Throughput of the encoder (uncompressed), in megabytes per second.
+	double throughput() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_seconds > 0 ? m_bytes / m_seconds / (1024 * 1024) : 0;
+	}
+
+private:
+	unsigned long m_count;
+	double m_bytes;
+	double m_seconds;
+	double m_max;
+
+	mutable boost::mutex m_mutex;
+};
+
+/*!
+ * \class EncodeTimer
+ * \brief Measures writing of single image, result is added to stats when the timer goes out of scope.
+ */
+class EncodeTimer {
+public:
+	EncodeTimer(EncodeStats & stats, const cv::Mat & img) :
+		m_stats(stats), m_bytes(img.total() * img.elemSize()),
+		m_start(boost::posix_time::microsec_clock::universal_time()) {
+	}
+
+	~EncodeTimer() {
+		boost::posix_time::time_duration d = boost::posix_time::microsec_clock::universal_time() - m_start;
+		m_stats.add(d.total_microseconds() / 1e6, m_bytes);
+	}
+
+private:
+	EncodeStats & m_stats;
+	size_t m_bytes;
+	boost::posix_time::ptime m_start;
+};
+
+} //: namespace Types
+
+#endif /* IMAGEENCODING_HPP_ */
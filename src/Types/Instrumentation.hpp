@@ -0,0 +1,350 @@
+/*!
+ * \file Instrumentation.hpp
+ * \brief Call counts, execution times and data volumes of component handlers
+ *
+ * Handler is measured by the probe, created at its beginning:
+ *
+ * \code
+ * void Component::onNewImage() {
+ *     INSTRUMENT_HANDLER(probe, "onNewImage");
+ *     cv::Mat img = in_img.read();
+ *     probe.bytesIn(img);
+ *     ...
+ *     probe.bytesOut(out);
+ * }
+ * \endcode
+ *
+ * Statistics are resolved once per component at each place of measurement, later calls
+ * only take the lock of their own handler. Statistics of all components in the process
+ * are periodically written to the CSV file, given by CVBASIC_INSTRUMENTATION_FILE environment variable (or set by
+ * Instrumentation::setExport), every CVBASIC_INSTRUMENTATION_PERIOD seconds (5 by default).
+ *
+ * When CVBASIC_NO_INSTRUMENTATION is defined (CVBASIC_INSTRUMENTATION CMake option
+ * turned off), probes are empty and compiled out completely.
+ */
+
+#ifndef INSTRUMENTATION_HPP_
+#define INSTRUMENTATION_HPP_
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Types {
+
+/*!
+ * \class HandlerStats
+ * \brief Statistics of single handler.
+ *
+ * Execution times are gathered in a histogram with logarithmic buckets, four per octave -
+ * k-th bucket counts calls which took from 2^(k/4) to 2^((k+1)/4) microseconds (first
+ * one - below 1.19 us, last one - above 16 s). Percentiles are interpolated inside the
+ * bucket, so their error is below 19% of the value.
+ */
+class HandlerStats {
+public:
+	enum { BucketsPerOctave = 4, Buckets = 24 * BucketsPerOctave };
+
+	/// Lower bound of the k-th bucket, in microseconds.
+	static double bucketStart(int k) {
+		return k > 0 ? std::pow(2.0, (double)k / BucketsPerOctave) : 0;
+	}
+
+	struct Snapshot {
+		unsigned long calls;
+		double seconds;
+		double max;
+		double bytes_in;
+		double bytes_out;
+		unsigned long histogram[Buckets];
+
+		/// Estimate of the p-th (0..1) percentile of execution time, in milliseconds.
+		double percentile(double p) const {
+			unsigned long rank = (unsigned long)(p * calls);
+			unsigned long sum = 0;
+			for (int k = 0; k < Buckets; ++k) {
+				if (sum + histogram[k] > rank) {
+					// Calls are assumed to be spread evenly over the bucket.
+					double f = (rank - sum + 0.5) / histogram[k];
+					double us = bucketStart(k) + f * (bucketStart(k + 1) - bucketStart(k));
+					return std::min(us / 1000, max * 1000);
+				}
+				sum += histogram[k];
+			}
+			return max * 1000;
+		}
+	};
+
+	HandlerStats() : m_check(0) {
+		reset();
+	}
+
+	void reset() {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_data.calls = 0;
+		m_data.seconds = m_data.max = 0;
+		m_data.bytes_in = m_data.bytes_out = 0;
+		std::fill(m_data.histogram, m_data.histogram + Buckets, 0);
+	}
+
+	/*!
+	 * Adds single call, which took given time and processed given amount of data.
+	 *
+	 * \param time time of the end of the call (as Instrumentation::now())
+	 * \return true if the export of the statistics should be checked (at most once a second)
+	 */
+	bool add(double seconds, size_t bytes_in, size_t bytes_out, double time) {
+		double us = seconds * 1e6;
+		int k = us > 1 ? (int)(std::log(us) / std::log(2.0) * BucketsPerOctave) : 0;
+		k = std::max(std::min(k, (int)Buckets - 1), 0);
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		++m_data.calls;
+		m_data.seconds += seconds;
+		m_data.max = std::max(m_data.max, seconds);
+		m_data.bytes_in += bytes_in;
+		m_data.bytes_out += bytes_out;
+		++m_data.histogram[k];
+
+		if (time < m_check)
+			return false;
+		m_check = time + 1;
+		return true;
+	}
+
+	Snapshot snapshot() const {
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_data;
+	}
+
+private:
+	Snapshot m_data;
+
+	/// Time of the next export check.
+	double m_check;
+
+	mutable boost::mutex m_mutex;
+};
+
+/*!
+ * \class Instrumentation
+ * \brief Process-wide registry of handler statistics.
+ */
+class Instrumentation {
+public:
+	static Instrumentation & instance() {
+		static Instrumentation inst;
+		return inst;
+	}
+
+	~Instrumentation() {
+		exportNow();
+	}
+
+	/// Returns statistics of given handler of given component (created on first use).
+	HandlerStats & handler(const std::string & component, const std::string & handler) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		boost::shared_ptr<HandlerStats> & stats = m_handlers[component + "." + handler];
+		if (!stats)
+			stats.reset(new HandlerStats);
+		return *stats;
+	}
+
+	/*!
+	 * Sets the file to which statistics are exported, empty name disables exporting.
+	 *
+	 * \param period time between exports, in seconds
+	 */
+	void setExport(const std::string & file, double period) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_file = file;
+		m_period = period;
+		m_next = now() + period;
+	}
+
+	/// Exports statistics if the export period has elapsed.
+	void exportIfDue(double time) {
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			if (m_file.empty() || time < m_next)
+				return;
+			m_next = time + m_period;
+		}
+		exportNow();
+	}
+
+	/*!
+	 * Writes statistics of all handlers to the export file (if set).
+	 *
+	 * \return false if the file couldn't be written
+	 */
+	bool exportNow() {
+		boost::mutex::scoped_lock lock(m_mutex);
+		if (m_file.empty())
+			return true;
+
+		std::ofstream out(m_file.c_str(), std::ios::trunc);
+		if (!out)
+			return false;
+
+		out << "handler,calls,total_ms,mean_ms,max_ms,p50_ms,p90_ms,p99_ms,mb_in,mb_out,histogram\n";
+		out << std::fixed << std::setprecision(3);
+		for (std::map<std::string, boost::shared_ptr<HandlerStats> >::const_iterator it = m_handlers.begin();
+				it != m_handlers.end(); ++it) {
+			HandlerStats::Snapshot s = it->second->snapshot();
+			out << it->first << "," << s.calls << "," << s.seconds * 1000 << ","
+					<< (s.calls ? s.seconds * 1000 / s.calls : 0) << "," << s.max * 1000 << ","
+					<< s.percentile(0.5) << "," << s.percentile(0.9) << "," << s.percentile(0.99) << ","
+					<< s.bytes_in / (1024 * 1024) << "," << s.bytes_out / (1024 * 1024) << ",";
+			for (int k = 0; k < HandlerStats::Buckets; ++k)
+				out << (k ? " " : "") << s.histogram[k];
+			out << "\n";
+		}
+		return true;
+	}
+
+	/// Current time in seconds (since epoch).
+	static double now() {
+		static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+		return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds() / 1e6;
+	}
+
+private:
+	Instrumentation() : m_period(5), m_next(0) {
+		const char * file = std::getenv("CVBASIC_INSTRUMENTATION_FILE");
+		const char * period = std::getenv("CVBASIC_INSTRUMENTATION_PERIOD");
+		if (period && std::atof(period) > 0)
+			m_period = std::atof(period);
+		if (file)
+			m_file = file;
+		m_next = now() + m_period;
+	}
+
+	std::map<std::string, boost::shared_ptr<HandlerStats> > m_handlers;
+
+	std::string m_file;
+
+	double m_period;
+
+	/// Time of the next export.
+	double m_next;
+
+	boost::mutex m_mutex;
+};
+
+#ifndef CVBASIC_NO_INSTRUMENTATION
+
+/*!
+ * \class HandlerSite
+ * \brief Statistics of the handler, resolved once for every component measured at given place.
+ *
+ * Site is a static object, shared by all instances of the component type - registry
+ * (and its global lock) is used only by the first call of each instance.
+ */
+class HandlerSite {
+public:
+	explicit HandlerSite(const char * handler) : m_handler(handler) {
+	}
+
+	template <typename Component>
+	HandlerStats & stats(const Component * owner) {
+		boost::mutex::scoped_lock lock(m_mutex);
+		for (size_t i = 0; i < m_stats.size(); ++i)
+			if (m_stats[i].first == owner)
+				return *m_stats[i].second;
+
+		HandlerStats & stats = Instrumentation::instance().handler(owner->name(), m_handler);
+		m_stats.push_back(std::make_pair((const void *)owner, &stats));
+		return stats;
+	}
+
+private:
+	const char * m_handler;
+
+	/// Statistics of components, by component address.
+	std::vector<std::pair<const void *, HandlerStats *> > m_stats;
+
+	boost::mutex m_mutex;
+};
+
+/*!
+ * \class Probe
+ * \brief Measures the handler from construction to destruction.
+ */
+class Probe {
+public:
+	explicit Probe(HandlerStats & stats) :
+		m_stats(stats), m_in(0), m_out(0), m_start(Instrumentation::now()) {
+	}
+
+	~Probe() {
+		double end = Instrumentation::now();
+		if (m_stats.add(end - m_start, m_in, m_out, end))
+			Instrumentation::instance().exportIfDue(end);
+	}
+
+	void bytesIn(size_t bytes) {
+		m_in += bytes;
+	}
+
+	void bytesIn(const cv::Mat & img) {
+		m_in += img.total() * img.elemSize();
+	}
+
+	void bytesOut(size_t bytes) {
+		m_out += bytes;
+	}
+
+	void bytesOut(const cv::Mat & img) {
+		m_out += img.total() * img.elemSize();
+	}
+
+private:
+	HandlerStats & m_stats;
+	size_t m_in;
+	size_t m_out;
+	double m_start;
+};
+
+/// Creates probe named var, measuring given handler of the component (has to be used inside component's method).
+#define INSTRUMENT_HANDLER(var, handler_name) \
+	static Types::HandlerSite var##_site(handler_name); \
+	Types::Probe var(var##_site.stats(this))
+
+#else
+
+class Probe {
+public:
+	void bytesIn(size_t) {
+	}
+
+	void bytesIn(const cv::Mat &) {
+	}
+
+	void bytesOut(size_t) {
+	}
+
+	void bytesOut(const cv::Mat &) {
+	}
+};
+
+#define INSTRUMENT_HANDLER(var, handler_name) \
+	Types::Probe var
+
+#endif /* CVBASIC_NO_INSTRUMENTATION */
+
+} //: namespace Types
+
+#endif /* INSTRUMENTATION_HPP_ */
@@ -0,0 +1,219 @@
+/*!
+ * \file ParallelFor.hpp
+ * \brief Parallel processing of row bands on the process-wide thread pool
+ *
+ * Image is split into bands of rows, processed by the calling thread and the
+ * threads of the pool, shared by all components in the process:
+ *
+ * \code
+ * void Component::processRows(const cv::Range & rows, const cv::Mat & src) {
+ *     cv::Mat dst_band = dst.rowRange(rows);
+ *     ...
+ * }
+ *
+ * dst.create(src.size(), src.type());
+ * Types::parallelRows(src.rows, threads, boost::bind(&Component::processRows, this, _1, boost::cref(src)));
+ * \endcode
+ *
+ * Output has to be allocated before, so every band writes to its own part of it.
+ */
+
+#ifndef PARALLELFOR_HPP_
+#define PARALLELFOR_HPP_
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <opencv2/core/core.hpp>
+
+namespace Types {
+
+/*!
+ * \class ThreadPool
+ * \brief Process-wide pool of threads executing parts of the loops.
+ *
+ * Threads are started on demand, when the loop asks for more of them than are
+ * running. Calling thread processes parts of its own loop too, so loops started
+ * from inside other loops never wait for free threads.
+ */
+class ThreadPool {
+public:
+	/// Body of the loop, processing given range of indices.
+	typedef boost::function<void(const cv::Range &)> Body;
+
+	/// Maximum number of threads of the pool.
+	enum { MaxThreads = 64 };
+
+	static ThreadPool & instance() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	~ThreadPool() {
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			m_stopping = true;
+		}
+		m_work.notify_all();
+
+		for (size_t i = 0; i < m_threads.size(); ++i)
+			m_threads[i]->join();
+	}
+
+	/// Number of hardware threads of the machine.
+	static int hardwareThreads() {
+		return std::max((int)boost::thread::hardware_concurrency(), 1);
+	}
+
+	/*!
+	 * Runs body over range 0..n, split into parts, and waits until all of them are processed.
+	 *
+	 * \param threads maximum number of threads working on the loop, including the calling one (0 - all cores)
+	 * \param parts number of parts
+	 * \throws std::runtime_error if body has thrown an exception for any part
+	 */
+	void run(const Body & body, int n, int threads, int parts) {
+		if (n <= 0)
+			return;
+
+		threads = std::min(threads > 0 ? threads : hardwareThreads(), (int)MaxThreads + 1);
+		parts = std::max(std::min(parts, n), 1);
+		if (threads == 1 || parts == 1) {
+			body(cv::Range(0, n));
+			return;
+		}
+
+		Job job;
+		job.body = &body;
+		job.n = n;
+		job.parts = parts;
+		job.next = job.done = job.helpers = 0;
+		job.max_helpers = threads - 1;
+		job.failed = false;
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		while ((int)m_threads.size() < job.max_helpers)
+			m_threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ThreadPool::work, this))));
+		m_jobs.push_back(&job);
+		m_work.notify_all();
+
+		process(job, lock);
+
+		// Job lives on the stack, so helpers have to leave it first.
+		while (job.done < job.parts || job.helpers > 0)
+			m_done.wait(lock);
+
+		if (job.failed)
+			throw std::runtime_error("ThreadPool: loop body failed");
+	}
+
+private:
+	struct Job {
+		const Body * body;
+		int n;
+		int parts;
+
+		/// Next part to be processed.
+		int next;
+
+		/// Number of processed parts.
+		int done;
+
+		/// Number of pool threads working on the job.
+		int helpers;
+		int max_helpers;
+
+		bool failed;
+	};
+
+	ThreadPool() : m_stopping(false) {
+	}
+
+	/// Processes parts of the job until there are none left, lock is held outside of the body.
+	void process(Job & job, boost::mutex::scoped_lock & lock) {
+		while (job.next < job.parts) {
+			int k = job.next++;
+			if (job.next == job.parts)
+				m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+
+			lock.unlock();
+			bool ok = true;
+			try {
+				(*job.body)(cv::Range((long long)k * job.n / job.parts, (long long)(k + 1) * job.n / job.parts));
+			} catch (...) {
+				ok = false;
+			}
+			lock.lock();
+
+			if (!ok)
+				job.failed = true;
+			if (++job.done == job.parts)
+				m_done.notify_all();
+		}
+	}
+
+	/// Pool thread body.
+	void work() {
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		for (;;) {
+			Job * job = NULL;
+			for (size_t i = 0; i < m_jobs.size() && !job; ++i)
+				if (m_jobs[i]->helpers < m_jobs[i]->max_helpers)
+					job = m_jobs[i];
+
+			if (!job) {
+				if (m_stopping)
+					return;
+				m_work.wait(lock);
+				continue;
+			}
+
+			++job->helpers;
+			process(*job, lock);
+			--job->helpers;
+			m_done.notify_all();
+		}
+	}
+
+	/// Jobs with unprocessed parts.
+	std::deque<Job *> m_jobs;
+
+	bool m_stopping;
+
+	boost::mutex m_mutex;
+
+	/// Signalled when job is added.
+	boost::condition_variable m_work;
+
+	/// Signalled when job is finished or helper leaves it.
+	boost::condition_variable m_done;
+
+	std::vector<boost::shared_ptr<boost::thread> > m_threads;
+};
+
+/*!
+ * Processes rows 0..rows in bands, using given number of threads.
+ *
+ * \param threads number of threads, including the calling one (0 - all cores, 1 - body is called once, for all rows)
+ * \param min_rows minimum height of the band
+ */
+inline void parallelRows(int rows, int threads, const ThreadPool::Body & body, int min_rows = 16) {
+	int t = threads > 0 ? threads : ThreadPool::hardwareThreads();
+	// Few bands per thread balance uneven load.
+	int parts = std::min(4 * t, std::max(rows / std::max(min_rows, 1), 1));
+	ThreadPool::instance().run(body, rows, t, parts);
+}
+
+} //: namespace Types
+
+#endif /* PARALLELFOR_HPP_ */
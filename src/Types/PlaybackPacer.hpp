@@ -0,0 +1,153 @@
+/*!
+ * \file PlaybackPacer.hpp
+ * \brief Real-time pacing of recorded frames
+ */
+
+#ifndef PLAYBACKPACER_HPP_
+#define PLAYBACKPACER_HPP_
+
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace Types {
+
+/*!
+ * \class PlaybackPacer
+ * \brief Delays frames so that they are emitted according to their capture timestamps.
+ *
+ * First frame (and every frame with timestamp earlier than the previous one, e.g.
+ * after the sequence looped) starts a new segment - following frames are due at
+ * segment start + (timestamp - first timestamp) / speed. Frames that are already
+ * overdue by more than the tolerance are counted as late and, optionally, dropped.
+ */
+class PlaybackPacer {
+public:
+	PlaybackPacer() : m_speed(1.0), m_tolerance(0.05), m_drop_late(false) {
+		resetCounters();
+		reset();
+	}
+
+	/*!
+	 * Sets playback speed multiplier. Values <= 0 disable pacing (as fast as possible).
+	 */
+	void setSpeed(double speed) {
+		m_speed = speed;
+		reset();
+	}
+
+	/*!
+	 * Sets how much (in seconds) frame can be overdue before it is treated as late.
+	 */
+	void setTolerance(double tolerance) {
+		m_tolerance = tolerance;
+	}
+
+	/*!
+	 * If set, late frames are reported as dropped (wait() returns false).
+	 */
+	void setDropLate(bool drop) {
+		m_drop_late = drop;
+	}
+
+	/*!
+	 * Starts new segment with the next frame.
+	 */
+	void reset() {
+		m_started = false;
+	}
+
+	void resetCounters() {
+		m_frames = 0;
+		m_late = 0;
+		m_dropped = 0;
+	}
+
+	/*!
+	 * Waits until frame with given timestamp (in seconds) is due.
+	 *
+	 * \return false if frame is late and should be dropped
+	 */
+	bool wait(double timestamp) {
+		++m_frames;
+
+		if (m_speed <= 0)
+			return true;
+
+		boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+		if (!m_started || timestamp < m_last) {
+			m_started = true;
+			m_start = now;
+			m_first = timestamp;
+			m_last = timestamp;
+			return true;
+		}
+		m_last = timestamp;
+
+		boost::posix_time::ptime due = m_start +
+				boost::posix_time::microseconds((long)((timestamp - m_first) / m_speed * 1e6));
+
+		if (now < due) {
+			boost::this_thread::sleep(due - now);
+			return true;
+		}
+
+		if ((now - due).total_microseconds() > m_tolerance * 1e6) {
+			++m_late;
+			if (m_drop_late) {
+				++m_dropped;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*!
+	 * Checks, without waiting, if frame with given timestamp would be late - so
+	 * that the source may skip decoding it.
+	 */
+	bool overdue(double timestamp) const {
+		if (m_speed <= 0 || !m_started || timestamp < m_last)
+			return false;
+
+		boost::posix_time::ptime due = m_start +
+				boost::posix_time::microseconds((long)((timestamp - m_first) / m_speed * 1e6));
+		boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+		return now > due && (now - due).total_microseconds() > m_tolerance * 1e6;
+	}
+
+	/// Number of frames passed to wait().
+	unsigned long frames() const {
+		return m_frames;
+	}
+
+	/// Number of frames overdue by more than the tolerance.
+	unsigned long late() const {
+		return m_late;
+	}
+
+	/// Number of late frames that were dropped.
+	unsigned long dropped() const {
+		return m_dropped;
+	}
+
+private:
+	double m_speed;
+	double m_tolerance;
+	bool m_drop_late;
+
+	bool m_started;
+	boost::posix_time::ptime m_start;
+	double m_first;
+	double m_last;
+
+	unsigned long m_frames;
+	unsigned long m_late;
+	unsigned long m_dropped;
+};
+
+} //: namespace Types
+
+#endif /* PLAYBACKPACER_HPP_ */
@@ -0,0 +1,278 @@
+/*!
+ * \file RangeMask.hpp
+ * \brief Vectorized thresholding of all channels of 3-channel images
+ */
+
+#ifndef RANGEMASK_HPP_
+#define RANGEMASK_HPP_
+
+#include <opencv2/core/core.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RANGEMASK_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RANGEMASK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Types {
+
+/*!
+ * \class RangeMask
+ * \brief Marks pixels of 8-bit, 3-channel image, with all channels within given ranges.
+ *
+ * Range with low > high matches nothing, unless wrapping is turned on for the channel
+ * (e.g. for hue) - then it wraps around, e.g. hue range 170..10 accepts 170..255 and 0..10.
+ * Result is 255 for the matching pixels and 0 otherwise.
+ *
+ * Rows are processed with the widest instructions supported by the processor, selected
+ * at run time: AVX2 (32 pixels at once) or SSSE3 (16 pixels), or with NEON on ARM.
+ * Remaining pixels (and other processors) are handled by the scalar code.
+ */
+class RangeMask {
+public:
+	enum Isa {
+		Scalar,
+		SSSE3,
+		AVX2,
+		NEON
+	};
+
+	RangeMask() {
+		for (int c = 0; c < 3; ++c) {
+			setRange(c, 0, 255);
+			setWrapping(c, false);
+		}
+	}
+
+	/// Sets range of c-th channel.
+	void setRange(int c, uchar low, uchar high) {
+		m_low[c] = low;
+		m_high[c] = high;
+	}
+
+	/// Sets if range of c-th channel with low > high wraps around (circular channels, like hue).
+	void setWrapping(int c, bool wrapping) {
+		m_wrapping[c] = wrapping;
+	}
+
+	/*!
+	 * Computes the mask of the image.
+	 *
+	 * \param src 8-bit, 3-channel image
+	 * \param dst 8-bit, 1-channel mask, (re)allocated if needed
+	 */
+	void apply(const cv::Mat & src, cv::Mat & dst, Isa isa = detect()) const {
+		CV_Assert(src.type() == CV_8UC3);
+		dst.create(src.size(), CV_8UC1);
+
+		cv::Size size = src.size();
+		// Continuous images are treated as single row.
+		if (src.isContinuous() && dst.isContinuous()) {
+			size.width *= size.height;
+			size.height = 1;
+		}
+
+		for (int y = 0; y < size.height; ++y)
+			row(src.ptr<uchar>(y), dst.ptr<uchar>(y), size.width, isa);
+	}
+
+	/// Returns the best instruction set supported by the processor.
+	static Isa detect() {
+#if defined(RANGEMASK_X86)
+		static const Isa isa = __builtin_cpu_supports("avx2") ? AVX2 : (__builtin_cpu_supports("ssse3") ? SSSE3 : Scalar);
+		return isa;
+#elif defined(RANGEMASK_NEON)
+		return NEON;
+#else
+		return Scalar;
+#endif
+	}
+
+	uchar low(int c) const {
+		return m_low[c];
+	}
+
+	uchar high(int c) const {
+		return m_high[c];
+	}
+
+	bool operator==(const RangeMask & other) const {
+		for (int c = 0; c < 3; ++c)
+			if (m_low[c] != other.m_low[c] || m_high[c] != other.m_high[c] || m_wrapping[c] != other.m_wrapping[c])
+				return false;
+		return true;
+	}
+
+	bool operator!=(const RangeMask & other) const {
+		return !(*this == other);
+	}
+
+	/// Returns true if value of c-th channel is within its range.
+	bool channelMatches(int c, uchar v) const {
+		return (m_low[c] <= m_high[c]) ? (v >= m_low[c] && v <= m_high[c]) : (m_wrapping[c] && (v >= m_low[c] || v <= m_high[c]));
+	}
+
+	/// Returns true if the pixel with given channels matches.
+	bool matches(uchar c0, uchar c1, uchar c2) const {
+		return channelMatches(0, c0) && channelMatches(1, c1) && channelMatches(2, c2);
+	}
+
+private:
+	/// Returns true if range of c-th channel wraps around.
+	bool wraps(int c) const {
+		return m_wrapping[c] && m_low[c] > m_high[c];
+	}
+
+	/// Processes n pixels.
+	void row(const uchar * src, uchar * dst, int n, Isa isa) const {
+		int done = 0;
+#if defined(RANGEMASK_X86)
+		if (isa == AVX2)
+			done = rowAvx2(src, dst, n);
+		else if (isa == SSSE3)
+			done = rowSsse3(src, dst, n);
+#elif defined(RANGEMASK_NEON)
+		if (isa == NEON)
+			done = rowNeon(src, dst, n);
+#endif
+		for (int i = done; i < n; ++i)
+			dst[i] = matches(src[3 * i], src[3 * i + 1], src[3 * i + 2]) ? 255 : 0;
+	}
+
+#if defined(RANGEMASK_X86)
+	/// Indices of c-th channel bytes of 16 pixels, in v-th of three 16-byte blocks (-1 - byte from other block).
+	static const signed char * shuffle(int v, int c) {
+		static const signed char table[3][3][16] = {
+			{
+				{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+				{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+				{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+			}, {
+				{-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+				{-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+				{-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1}
+			}, {
+				{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13},
+				{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14},
+				{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}
+			}
+		};
+		return table[v][c];
+	}
+
+	__attribute__((target("ssse3")))
+	int rowSsse3(const uchar * src, uchar * dst, int n) const {
+		__m128i shuf[3][3], low[3], high[3], wrap[3];
+		for (int c = 0; c < 3; ++c) {
+			for (int v = 0; v < 3; ++v)
+				shuf[v][c] = _mm_loadu_si128((const __m128i *)shuffle(v, c));
+			low[c] = _mm_set1_epi8((char)m_low[c]);
+			high[c] = _mm_set1_epi8((char)m_high[c]);
+			wrap[c] = _mm_set1_epi8(wraps(c) ? -1 : 0);
+		}
+		const __m128i zero = _mm_setzero_si128();
+
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			const uchar * p = src + 3 * i;
+			__m128i x0 = _mm_loadu_si128((const __m128i *)p);
+			__m128i x1 = _mm_loadu_si128((const __m128i *)(p + 16));
+			__m128i x2 = _mm_loadu_si128((const __m128i *)(p + 32));
+
+			__m128i result = _mm_set1_epi8(-1);
+			for (int c = 0; c < 3; ++c) {
+				// Deinterleave c-th channel.
+				__m128i x = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x0, shuf[0][c]), _mm_shuffle_epi8(x1, shuf[1][c])),
+						_mm_shuffle_epi8(x2, shuf[2][c]));
+
+				// Saturated difference is zero if x >= low (x <= high).
+				__m128i ge = _mm_cmpeq_epi8(_mm_subs_epu8(low[c], x), zero);
+				__m128i le = _mm_cmpeq_epi8(_mm_subs_epu8(x, high[c]), zero);
+				__m128i ok = _mm_or_si128(_mm_and_si128(ge, le), _mm_and_si128(wrap[c], _mm_or_si128(ge, le)));
+				result = _mm_and_si128(result, ok);
+			}
+
+			_mm_storeu_si128((__m128i *)(dst + i), result);
+		}
+		return i;
+	}
+
+	__attribute__((target("avx2")))
+	int rowAvx2(const uchar * src, uchar * dst, int n) const {
+		// Lower lanes hold the first 16 pixels, upper lanes - the next 16, so the same shuffles as in SSSE3 apply.
+		__m256i shuf[3][3], low[3], high[3], wrap[3];
+		for (int c = 0; c < 3; ++c) {
+			for (int v = 0; v < 3; ++v)
+				shuf[v][c] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)shuffle(v, c)));
+			low[c] = _mm256_set1_epi8((char)m_low[c]);
+			high[c] = _mm256_set1_epi8((char)m_high[c]);
+			wrap[c] = _mm256_set1_epi8(wraps(c) ? -1 : 0);
+		}
+		const __m256i zero = _mm256_setzero_si256();
+
+		int i = 0;
+		for (; i + 32 <= n; i += 32) {
+			const uchar * p = src + 3 * i;
+			__m256i x0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+					_mm_loadu_si128((const __m128i *)(p + 48)), 1);
+			__m256i x1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 16))),
+					_mm_loadu_si128((const __m128i *)(p + 64)), 1);
+			__m256i x2 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(p + 32))),
+					_mm_loadu_si128((const __m128i *)(p + 80)), 1);
+
+			__m256i result = _mm256_set1_epi8(-1);
+			for (int c = 0; c < 3; ++c) {
+				__m256i x = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(x0, shuf[0][c]), _mm256_shuffle_epi8(x1, shuf[1][c])),
+						_mm256_shuffle_epi8(x2, shuf[2][c]));
+
+				__m256i ge = _mm256_cmpeq_epi8(_mm256_subs_epu8(low[c], x), zero);
+				__m256i le = _mm256_cmpeq_epi8(_mm256_subs_epu8(x, high[c]), zero);
+				__m256i ok = _mm256_or_si256(_mm256_and_si256(ge, le), _mm256_and_si256(wrap[c], _mm256_or_si256(ge, le)));
+				result = _mm256_and_si256(result, ok);
+			}
+
+			_mm256_storeu_si256((__m256i *)(dst + i), result);
+		}
+		return i;
+	}
+#endif /* RANGEMASK_X86 */
+
+#if defined(RANGEMASK_NEON)
+	int rowNeon(const uchar * src, uchar * dst, int n) const {
+		uint8x16_t low[3], high[3], wrap[3];
+		for (int c = 0; c < 3; ++c) {
+			low[c] = vdupq_n_u8(m_low[c]);
+			high[c] = vdupq_n_u8(m_high[c]);
+			wrap[c] = vdupq_n_u8(wraps(c) ? 0xFF : 0);
+		}
+
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			uint8x16x3_t x = vld3q_u8(src + 3 * i);
+
+			uint8x16_t result = vdupq_n_u8(0xFF);
+			for (int c = 0; c < 3; ++c) {
+				uint8x16_t ge = vcgeq_u8(x.val[c], low[c]);
+				uint8x16_t le = vcleq_u8(x.val[c], high[c]);
+				uint8x16_t ok = vorrq_u8(vandq_u8(ge, le), vandq_u8(wrap[c], vorrq_u8(ge, le)));
+				result = vandq_u8(result, ok);
+			}
+
+			vst1q_u8(dst + i, result);
+		}
+		return i;
+	}
+#endif /* RANGEMASK_NEON */
+
+	uchar m_low[3];
+	uchar m_high[3];
+	bool m_wrapping[3];
+};
+
+} //: namespace Types
+
+#endif /* RANGEMASK_HPP_ */